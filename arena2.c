@@ -0,0 +1,251 @@
+/*******************************************************************************
+ *
+ *                     arena2.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of UArray2_Arena. An arena is a
+ *     list of chunks of memory. Allocations are carved from the current chunk
+ *     by bumping an offset; when a request does not fit, the arena moves on to
+ *     the next chunk, adding one twice the size of the last if there is none.
+ *     Resetting the arena rewinds it to its first chunk. If the last batch
+ *     needed more than one chunk, the reset also replaces the chunks with a
+ *     single one as large as all of them together, so that from then on a
+ *     batch of the same size is served from one contiguous region without
+ *     calling malloc at all.
+ *
+ ******************************************************************************/
+#include "arena2.h"
+#include "except.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+/* every allocation is aligned as malloc would align it on common platforms */
+#define ARENA_ALIGN 16
+
+struct chunk {
+        struct chunk *next;
+        size_t capacity;
+        char *data;
+};
+
+struct UArray2_Arena_T {
+        struct chunk *first;
+        struct chunk *current;
+        size_t offset;          /* bytes used in the current chunk */
+        size_t used;            /* bytes handed out since the last reset */
+};
+
+static struct chunk *new_chunk(size_t capacity);
+static void free_chunks(struct chunk *chunk);
+
+/********** UArray2_Arena_new ********
+ *
+ * Allocates, initializes, and returns a new, empty arena.
+ *
+ * Parameters:
+ *      capacity: the number of bytes to reserve up front
+ *
+ * Return: A UArray2_Arena_T, which is a pointer to the UArray2_Arena_T
+ *         defined at the top of this file.
+ *
+ * Expects
+ *      Capacity is positive.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met, or if the memory
+ *              cannot be allocated. Malloc's memory that will be free'd by
+ *              UArray2_Arena_free. The arena grows as needed, so the capacity
+ *              is only a hint; sizing it for a whole batch avoids growing.
+ ************************/
+UArray2_Arena_T UArray2_Arena_new(size_t capacity) {
+        assert(capacity > 0);
+
+        UArray2_Arena_T arena = malloc(sizeof(*arena));
+        assert(arena != NULL);
+        arena->first = new_chunk(capacity);
+        arena->current = arena->first;
+        arena->offset = 0;
+        arena->used = 0;
+        return arena;
+}
+
+/********** UArray2_Arena_alloc ********
+ *
+ * Allocates zeroed memory from the arena.
+ *
+ * Parameters:
+ *      arena: pointer to a UArray2_Arena_T struct
+ *      bytes: the number of bytes to allocate
+ *
+ * Return: A pointer to bytes bytes of zeroed memory, aligned to ARENA_ALIGN.
+ *
+ * Expects
+ *      arena is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met, or if the arena needs
+ *              to grow and the memory cannot be allocated. The memory stays
+ *              valid until the arena is reset or freed; it cannot be free'd
+ *              on its own.
+ ************************/
+void *UArray2_Arena_alloc(UArray2_Arena_T arena, size_t bytes) {
+        assert(arena != NULL);
+        assert(bytes <= SIZE_MAX - ARENA_ALIGN);
+
+        for (;;) {
+                struct chunk *chunk = arena->current;
+                uintptr_t start = (uintptr_t)(chunk->data + arena->offset);
+                size_t pad = (ARENA_ALIGN - start % ARENA_ALIGN) %
+                             ARENA_ALIGN;
+                if (pad + bytes <= chunk->capacity - arena->offset) {
+                        char *p = chunk->data + arena->offset + pad;
+                        memset(p, 0, bytes);
+                        arena->offset += pad + bytes;
+                        arena->used += bytes;
+                        return p;
+                }
+
+                /* move on to the next chunk, adding one if there is none */
+                if (chunk->next == NULL) {
+                        size_t capacity = chunk->capacity;
+                        capacity = (capacity <= SIZE_MAX / 2) ? 2 * capacity
+                                                              : SIZE_MAX;
+                        if (capacity < bytes + ARENA_ALIGN) {
+                                capacity = bytes + ARENA_ALIGN;
+                        }
+                        chunk->next = new_chunk(capacity);
+                }
+                arena->current = chunk->next;
+                arena->offset = 0;
+        }
+}
+
+/********** UArray2_Arena_reset ********
+ *
+ * Releases everything allocated from the arena at once.
+ *
+ * Parameters:
+ *      arena: pointer to a UArray2_Arena_T struct
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      arena is not NULL.
+ *      No structure allocated from the arena is used after the reset.
+ *
+ * Notes:
+ *      Will CRE if the first expectation is not met. Takes constant time when
+ *              the arena has a single chunk; otherwise the chunks are merged
+ *              into one, so the cost is paid once per growth of the arena.
+ *              UArray2_free and Bit2_free need not be called on structures
+ *              allocated from the arena, though doing so is harmless.
+ ************************/
+void UArray2_Arena_reset(UArray2_Arena_T arena) {
+        assert(arena != NULL);
+
+        if (arena->first->next != NULL) {
+                size_t capacity = 0;
+                for (struct chunk *c = arena->first; c != NULL; c = c->next) {
+                        capacity = (capacity <= SIZE_MAX - c->capacity)
+                                   ? capacity + c->capacity : SIZE_MAX;
+                }
+                free_chunks(arena->first);
+                arena->first = new_chunk(capacity);
+        }
+        arena->current = arena->first;
+        arena->offset = 0;
+        arena->used = 0;
+}
+
+/********** UArray2_Arena_used ********
+ *
+ * Gets the number of bytes allocated from the arena since it was created or
+ * last reset.
+ *
+ * Parameters:
+ *      arena: pointer to a UArray2_Arena_T struct
+ *
+ * Return: The total of the sizes passed to UArray2_Arena_alloc, not counting
+ *         alignment padding.
+ *
+ * Expects
+ *      arena is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+size_t UArray2_Arena_used(UArray2_Arena_T arena) {
+        assert(arena != NULL);
+        return arena->used;
+}
+
+/********** UArray2_Arena_free ********
+ *
+ * Frees the arena and everything allocated from it.
+ *
+ * Parameters:
+ *      arena: a pointer to a pointer to a UArray2_Arena_T struct.
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      arena and *arena are not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Sets *arena to NULL.
+ ************************/
+void UArray2_Arena_free(UArray2_Arena_T *arena) {
+        assert(arena != NULL);
+        assert(*arena != NULL);
+        free_chunks((*arena)->first);
+        free(*arena);
+        *arena = NULL;
+}
+
+/********** new_chunk ********
+ *
+ * Allocates a chunk with room for capacity bytes, in a single allocation.
+ *
+ * Parameters:
+ *      capacity: the number of bytes the chunk holds
+ *
+ * Return: A pointer to the new chunk, with no next chunk.
+ *
+ * Expects
+ *      The memory can be allocated.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+static struct chunk *new_chunk(size_t capacity) {
+        assert(capacity <= SIZE_MAX - sizeof(struct chunk));
+        struct chunk *chunk = malloc(sizeof(*chunk) + capacity);
+        assert(chunk != NULL);
+        chunk->next = NULL;
+        chunk->capacity = capacity;
+        chunk->data = (char *)(chunk + 1);
+        return chunk;
+}
+
+/********** free_chunks ********
+ *
+ * Frees a chunk and every chunk after it.
+ *
+ * Parameters:
+ *      chunk: the first chunk to free
+ *
+ * Return: no return value
+ ************************/
+static void free_chunks(struct chunk *chunk) {
+        while (chunk != NULL) {
+                struct chunk *next = chunk->next;
+                free(chunk);
+                chunk = next;
+        }
+}
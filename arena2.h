@@ -0,0 +1,35 @@
+/*******************************************************************************
+ *
+ *                     arena2.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides the interface for UArray2_Arena, a region allocator
+ *     for programs that create and free many small UArray2s and Bit2s.
+ *     UArray2_new_in and Bit2_new_in carve both the handle and the elements
+ *     of a new structure out of an arena with a single bump of a pointer, and
+ *     UArray2_Arena_reset releases everything allocated from the arena at
+ *     once, keeping its memory for the next batch. In this file, we typedef
+ *     UArray2_Arena_T to be a pointer to a UArray2_Arena_T struct, as defined
+ *     in the implementation.
+ *
+ *     The arena is named for UArray2 to stay clear of Hanson's Arena_T, whose
+ *     Arena_ functions live in the same library we link against.
+ *
+ ******************************************************************************/
+#ifndef ARENA2_INCLUDED
+#define ARENA2_INCLUDED
+
+#include <stddef.h>
+
+typedef struct UArray2_Arena_T *UArray2_Arena_T;
+
+UArray2_Arena_T UArray2_Arena_new(size_t capacity);
+void *UArray2_Arena_alloc(UArray2_Arena_T arena, size_t bytes);
+extern void UArray2_Arena_reset(UArray2_Arena_T arena);
+extern size_t UArray2_Arena_used(UArray2_Arena_T arena);
+extern void UArray2_Arena_free(UArray2_Arena_T *arena);
+
+#endif
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ *
+ *                     bencharena.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark of the batch sudoku workload: JOBS times
+ *     over (1000000 by default), create a 9 x 9 UArray2 of unsigned and a
+ *     9 x 9 Bit2, fill them, read them back, and drop them. It runs the
+ *     workload once with UArray2_new/Bit2_new and UArray2_free/Bit2_free, and
+ *     once with UArray2_new_in/Bit2_new_in on an arena that is reset after
+ *     every BATCH jobs (1000 by default), and prints the time taken and the
+ *     number of calls to malloc and calloc made by each.
+ *
+ *     The calls are counted by linking with -Wl,--wrap=malloc,--wrap=calloc
+ *     (see the Makefile), which routes every call to malloc and calloc in the
+ *     program, including those inside uarray2.o and bit2.o, through the
+ *     __wrap_ functions below.
+ *     Usage: bencharena [jobs [batch]]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "uarray2.h"
+#include "bit2.h"
+#include "arena2.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+void *__real_malloc(size_t bytes);
+void *__real_calloc(size_t count, size_t bytes);
+void *__wrap_malloc(size_t bytes);
+void *__wrap_calloc(size_t count, size_t bytes);
+
+static unsigned long allocations = 0;
+
+static double now(void);
+static unsigned long fill_and_sum(UArray2_T grid, Bit2_T marks, int job);
+
+int main(int argc, char *argv[])
+{
+        assert(argc <= 3);
+        int jobs = (argc >= 2) ? atoi(argv[1]) : 1000000;
+        int batch = (argc == 3) ? atoi(argv[2]) : 1000;
+        assert(jobs > 0 && batch > 0);
+
+        unsigned long heap_sum = 0;
+        unsigned long before = allocations;
+        double start = now();
+        for (int job = 0; job < jobs; job++) {
+                UArray2_T grid = UArray2_new(9, 9, sizeof(unsigned));
+                Bit2_T marks = Bit2_new(9, 9);
+                heap_sum += fill_and_sum(grid, marks, job);
+                Bit2_free(&marks);
+                UArray2_free(&grid);
+        }
+        double heap_time = now() - start;
+        unsigned long heap_allocs = allocations - before;
+
+        unsigned long arena_sum = 0;
+        before = allocations;
+        start = now();
+        UArray2_Arena_T arena = UArray2_Arena_new(4096);
+        for (int job = 0; job < jobs; job++) {
+                UArray2_T grid = UArray2_new_in(arena, 9, 9,
+                                                sizeof(unsigned));
+                Bit2_T marks = Bit2_new_in(arena, 9, 9);
+                arena_sum += fill_and_sum(grid, marks, job);
+                if ((job + 1) % batch == 0) {
+                        UArray2_Arena_reset(arena);
+                }
+        }
+        UArray2_Arena_free(&arena);
+        double arena_time = now() - start;
+        unsigned long arena_allocs = allocations - before;
+
+        assert(heap_sum == arena_sum);
+        printf("%d jobs, arena reset every %d jobs\n", jobs, batch);
+        printf("%-22s %8s %14s\n", "", "seconds", "malloc+calloc");
+        printf("%-22s %8.3f %14lu\n", "heap (new/free)", heap_time,
+               heap_allocs);
+        printf("%-22s %8.3f %14lu\n", "arena (new_in/reset)", arena_time,
+               arena_allocs);
+        return EXIT_SUCCESS;
+}
+
+/********** __wrap_malloc ********
+ *
+ * Counts a call to malloc and passes it on.
+ ************************/
+void *__wrap_malloc(size_t bytes)
+{
+        allocations++;
+        return __real_malloc(bytes);
+}
+
+/********** __wrap_calloc ********
+ *
+ * Counts a call to calloc and passes it on.
+ ************************/
+void *__wrap_calloc(size_t count, size_t bytes)
+{
+        allocations++;
+        return __real_calloc(count, bytes);
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** fill_and_sum ********
+ *
+ * Fills the grid with a shifted sudoku solution and marks the cells holding
+ * 9, then reads both back.
+ *
+ * Parameters:
+ *      UArray2_T grid: a 9 x 9 UArray2 of unsigned
+ *      Bit2_T marks: a 9 x 9 Bit2
+ *      int job: the job number, which picks the shift
+ *
+ * Return: A checksum of the values read back, so that the two runs can be
+ *         compared and the work cannot be optimized away.
+ ************************/
+static unsigned long fill_and_sum(UArray2_T grid, Bit2_T marks, int job)
+{
+        unsigned long sum = 0;
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        unsigned n = (row * 3 + row / 3 + col + job) % 9 + 1;
+                        *(unsigned *)UArray2_at(grid, col, row) = n;
+                        Bit2_put(marks, col, row, n == 9);
+                }
+        }
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        sum += *(unsigned *)UArray2_at(grid, col, row) *
+                               (1 + Bit2_get(marks, col, row));
+                }
+        }
+        return sum;
+}
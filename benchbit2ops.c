@@ -0,0 +1,113 @@
+/*******************************************************************************
+ *
+ *                     benchbit2ops.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark of comparing a scan against a template,
+ *     the way a cleaned scan is checked: count the pixels where two DIM x DIM
+ *     Bit2s differ (16384 x 16384 by default). It times a double loop of
+ *     Bit2_get calls, then Bit2_xor followed by Bit2_popcount, then
+ *     Bit2_andnot and Bit2_popcount on their own, and prints the time taken
+ *     by each along with the rate at which the bulk operations move memory.
+ *     Usage: benchbit2ops [dim]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "bit2.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void);
+static void fill(Bit2_T B2, uint64_t seed);
+
+int main(int argc, char *argv[])
+{
+        assert(argc <= 2);
+        int dim = (argc == 2) ? atoi(argv[1]) : 16384;
+        assert(dim > 0);
+
+        Bit2_T scan = Bit2_new(dim, dim);
+        Bit2_T template = Bit2_new(dim, dim);
+        Bit2_T diff = Bit2_new(dim, dim);
+        fill(scan, 1);
+        fill(template, 2);
+        Bit2_not(diff, scan);   /* fault in diff so that it is not timed */
+        double bytes = (double)Bit2_words_per_row(scan) * dim * 8;
+
+        double start = now();
+        size_t loop_count = 0;
+        for (int row = 0; row < dim; row++) {
+                for (int col = 0; col < dim; col++) {
+                        loop_count += Bit2_get(scan, col, row) !=
+                                      Bit2_get(template, col, row);
+                }
+        }
+        double loop_time = now() - start;
+
+        start = now();
+        Bit2_xor(diff, scan, template);
+        double xor_time = now() - start;
+        start = now();
+        size_t bulk_count = Bit2_popcount(diff);
+        double count_time = now() - start;
+        assert(bulk_count == loop_count);
+
+        start = now();
+        Bit2_andnot(diff, scan, template);
+        double andnot_time = now() - start;
+
+        printf("%d x %d pixels, %zu differ\n", dim, dim, bulk_count);
+        printf("Bit2_get loop:        %8.3f s\n", loop_time);
+        printf("Bit2_xor + popcount:  %8.3f s\n", xor_time + count_time);
+        printf("Bit2_xor:             %8.3f s  %6.2f GB/s\n", xor_time,
+               3 * bytes / xor_time / 1e9);
+        printf("Bit2_andnot:          %8.3f s  %6.2f GB/s\n", andnot_time,
+               3 * bytes / andnot_time / 1e9);
+        printf("Bit2_popcount:        %8.3f s  %6.2f GB/s\n", count_time,
+               bytes / count_time / 1e9);
+
+        Bit2_free(&scan);
+        Bit2_free(&template);
+        Bit2_free(&diff);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** fill ********
+ *
+ * Fills a Bit2 with pseudo-random bits, one word at a time.
+ *
+ * Parameters:
+ *      Bit2_T B2: the Bit2 to fill
+ *      uint64_t seed: the seed of the xorshift generator
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void fill(Bit2_T B2, uint64_t seed)
+{
+        uint64_t x = seed * 0x9e3779b97f4a7c15u;
+        for (int row = 0; row < Bit2_height(B2); row++) {
+                for (int word = 0; word < Bit2_words_per_row(B2); word++) {
+                        x ^= x << 13;
+                        x ^= x >> 7;
+                        x ^= x << 17;
+                        Bit2_put_word(B2, word, row, x);
+                }
+        }
+}
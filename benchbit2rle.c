@@ -0,0 +1,224 @@
+/*******************************************************************************
+ *
+ *                     benchbit2rle.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing the dense Bit2 against the
+ *     run-length-encoded Bit2RLE on two synthetic WIDTH x HEIGHT pages
+ *     (10200 x 13200 by default, a letter page at 1200 dpi): a sparse page
+ *     of text-like glyphs with a few percent ink, and a dense page of
+ *     random noise. For each page it prints the memory each structure
+ *     occupies, the time to count the black pixels by traversing the set
+ *     bits (Bit2_map_set_bits) or the runs (Bit2RLE_map_runs), and the time
+ *     for a full Bit2_map_row_major or Bit2RLE_map_row_major pass.
+ *     Usage: benchbit2rle [width height]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "bit2.h"
+#include "bit2rle.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void);
+static void run_page(Bit2_T page, const char *name);
+static void draw_text(Bit2_T page);
+static void draw_noise(Bit2_T page);
+static void count_bit(int col, int row, Bit2_T B2, void *cl);
+static void count_run(int row, int start, int length, void *cl);
+static void sum_dense(int col, int row, Bit2_T B2, int val, void *cl);
+static void sum_rle(int col, int row, Bit2RLE_T B, int val, void *cl);
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1 || argc == 3);
+        int width = (argc == 3) ? atoi(argv[1]) : 10200;
+        int height = (argc == 3) ? atoi(argv[2]) : 13200;
+        assert(width > 0 && height > 0);
+
+        printf("%d x %d pages, times in seconds, memory in bytes\n", width,
+               height);
+        printf("%-6s %-8s %12s %10s %10s %10s\n", "page", "type", "memory",
+               "ink", "set bits", "row-major");
+
+        Bit2_T page = Bit2_new(width, height);
+        draw_text(page);
+        run_page(page, "sparse");
+        Bit2_free(&page);
+
+        page = Bit2_new(width, height);
+        draw_noise(page);
+        run_page(page, "dense");
+        Bit2_free(&page);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** run_page ********
+ *
+ * Converts a page to a Bit2RLE, times both representations, and prints one
+ * row of results for each.
+ *
+ * Parameters:
+ *      Bit2_T page: the page
+ *      const char *name: the name to print for the page
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void run_page(Bit2_T page, const char *name)
+{
+        Bit2RLE_T rle = Bit2RLE_from_bit2(page);
+        size_t dense_memory = (size_t)Bit2_words_per_row(page) *
+                              Bit2_height(page) * sizeof(uint64_t);
+
+        long dense_ink = 0;
+        double start = now();
+        Bit2_map_set_bits(page, count_bit, &dense_ink);
+        double dense_sparse = now() - start;
+        long dense_sum = 0;
+        start = now();
+        Bit2_map_row_major(page, sum_dense, &dense_sum);
+        double dense_full = now() - start;
+
+        long rle_ink = 0;
+        start = now();
+        Bit2RLE_map_runs(rle, count_run, &rle_ink);
+        double rle_sparse = now() - start;
+        long rle_sum = 0;
+        start = now();
+        Bit2RLE_map_row_major(rle, sum_rle, &rle_sum);
+        double rle_full = now() - start;
+
+        assert(dense_ink == rle_ink && dense_sum == rle_sum);
+        assert((size_t)dense_ink == Bit2_popcount(page));
+        printf("%-6s %-8s %12zu %9.2f%% %10.3f %10.3f\n", name, "Bit2",
+               dense_memory,
+               100.0 * dense_ink / Bit2_width(page) / Bit2_height(page),
+               dense_sparse, dense_full);
+        printf("%-6s %-8s %12zu %10s %10.3f %10.3f\n", name, "Bit2RLE",
+               Bit2RLE_memory(rle), "", rle_sparse, rle_full);
+        Bit2RLE_free(&rle);
+}
+
+/********** draw_text ********
+ *
+ * Draws lines of text-like glyphs on a page, the way a 12 point font looks
+ * at 1200 dpi: each glyph is two vertical strokes joined by a horizontal 
+ * bar, with spaces between words, wide margins, and blank space between 
+ * lines.
+ *
+ * Parameters:
+ *      Bit2_T page: the page to draw on
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void draw_text(Bit2_T page)
+{
+        int width = Bit2_width(page);
+        int height = Bit2_height(page);
+        unsigned seed = 1;
+        for (int top = 1200; top + 120 < height - 1200; top += 300) {
+                for (int left = 1200; left + 100 < width - 1200; 
+                     left += 120) {
+                        seed = seed * 1103515245 + 12345;
+                        if ((seed >> 16) % 6 == 0) {
+                                continue;       /* a space */
+                        }
+                        for (int row = top; row < top + 120; row++) {
+                                for (int col = left; col < left + 12; col++) {
+                                        Bit2_put(page, col, row, 1);
+                                        Bit2_put(page, col + 80, row, 1);
+                                }
+                        }
+                        for (int row = top + 55; row < top + 67; row++) {
+                                for (int col = left + 12; col < left + 80;
+                                     col++) {
+                                        Bit2_put(page, col, row, 1);
+                                }
+                        }
+                }
+        }
+}
+
+/********** draw_noise ********
+ *
+ * Fills a page with random bits, one word at a time.
+ *
+ * Parameters:
+ *      Bit2_T page: the page to fill
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void draw_noise(Bit2_T page)
+{
+        uint64_t x = 0x9e3779b97f4a7c15u;
+        for (int row = 0; row < Bit2_height(page); row++) {
+                for (int word = 0; word < Bit2_words_per_row(page); word++) {
+                        x ^= x << 13;
+                        x ^= x >> 7;
+                        x ^= x << 17;
+                        Bit2_put_word(page, word, row, x);
+                }
+        }
+}
+
+/********** count_bit ********
+ *
+ * Set-bit map function that counts the bits visited in the long at cl.
+ ************************/
+static void count_bit(int col, int row, Bit2_T B2, void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)B2;
+        (*(long *)cl)++;
+}
+
+/********** count_run ********
+ *
+ * Run map function that adds the length of each run to the long at cl.
+ ************************/
+static void count_run(int row, int start, int length, void *cl)
+{
+        (void)row;
+        (void)start;
+        *(long *)cl += length;
+}
+
+/********** sum_dense ********
+ *
+ * Map function that adds the column of each set bit to the long at cl.
+ ************************/
+static void sum_dense(int col, int row, Bit2_T B2, int val, void *cl)
+{
+        (void)row;
+        (void)B2;
+        *(long *)cl += val * col;
+}
+
+/********** sum_rle ********
+ *
+ * Map function that adds the column of each set bit to the long at cl.
+ ************************/
+static void sum_rle(int col, int row, Bit2RLE_T B, int val, void *cl)
+{
+        (void)row;
+        (void)B;
+        *(long *)cl += val * col;
+}
@@ -0,0 +1,253 @@
+/*******************************************************************************
+ *
+ *                     benchbit2roar.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing the dense Bit2, the
+ *     run-length-encoded Bit2RLE, and the tiled Bit2Roar on a synthetic
+ *     WIDTH x HEIGHT page of mixed density (10200 x 13200 by default, a
+ *     letter page at 1200 dpi): wide empty margins, a column of text-like
+ *     glyphs, a dithered photo of random noise, and a solid black bar. It
+ *     prints the memory each structure occupies, the time to count the black
+ *     pixels by traversing the set bits (or the runs, for Bit2RLE), the time
+ *     for a million random gets, and, for Bit2 and Bit2Roar, the time to AND
+ *     the page with a mask covering its left half.
+ *     Usage: benchbit2roar [width height]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "bit2.h"
+#include "bit2rle.h"
+#include "bit2roar.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define GETS 1000000
+
+static double now(void);
+static void draw_page(Bit2_T page);
+static void fill(Bit2_T page, int left, int top, int right, int bottom);
+static void count_bit(int col, int row, Bit2_T B2, void *cl);
+static void count_roar(int col, int row, Bit2Roar_T B, void *cl);
+static void count_run(int row, int start, int length, void *cl);
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1 || argc == 3);
+        int width = (argc == 3) ? atoi(argv[1]) : 10200;
+        int height = (argc == 3) ? atoi(argv[2]) : 13200;
+        assert(width > 0 && height > 0);
+
+        Bit2_T page = Bit2_new(width, height);
+        draw_page(page);
+        Bit2RLE_T rle = Bit2RLE_from_bit2(page);
+        Bit2Roar_T roar = Bit2Roar_from_bit2(page);
+        size_t dense_memory = (size_t)Bit2_words_per_row(page) * height *
+                              sizeof(uint64_t);
+
+        /* the same pseudo-random positions for every structure */
+        int *cols = malloc(GETS * sizeof(int));
+        int *rows = malloc(GETS * sizeof(int));
+        assert(cols != NULL && rows != NULL);
+        unsigned seed = 7;
+        for (int i = 0; i < GETS; i++) {
+                seed = seed * 1103515245 + 12345;
+                cols[i] = (seed >> 8) % width;
+                seed = seed * 1103515245 + 12345;
+                rows[i] = (seed >> 8) % height;
+        }
+
+        long dense_ink = 0, rle_ink = 0, roar_ink = 0;
+        long dense_hits = 0, rle_hits = 0, roar_hits = 0;
+        double start = now();
+        Bit2_map_set_bits(page, count_bit, &dense_ink);
+        double dense_scan = now() - start;
+        start = now();
+        for (int i = 0; i < GETS; i++) {
+                dense_hits += Bit2_get(page, cols[i], rows[i]);
+        }
+        double dense_get = now() - start;
+
+        start = now();
+        Bit2RLE_map_runs(rle, count_run, &rle_ink);
+        double rle_scan = now() - start;
+        start = now();
+        for (int i = 0; i < GETS; i++) {
+                rle_hits += Bit2RLE_get(rle, cols[i], rows[i]);
+        }
+        double rle_get = now() - start;
+
+        start = now();
+        Bit2Roar_map_set_bits(roar, count_roar, &roar_ink);
+        double roar_scan = now() - start;
+        start = now();
+        for (int i = 0; i < GETS; i++) {
+                roar_hits += Bit2Roar_get(roar, cols[i], rows[i]);
+        }
+        double roar_get = now() - start;
+
+        assert(dense_ink == rle_ink && dense_ink == roar_ink);
+        assert(dense_hits == rle_hits && dense_hits == roar_hits);
+
+        /* AND with a mask of the left half, as when cropping a region */
+        Bit2_T mask = Bit2_new(width, height);
+        fill(mask, 0, 0, width / 2, height);
+        Bit2_T dense_and = Bit2_new(width, height);
+        Bit2_not(dense_and, mask);      /* fault in the pages */
+        start = now();
+        Bit2_and(dense_and, page, mask);
+        double dense_op = now() - start;
+
+        Bit2Roar_T roar_mask = Bit2Roar_from_bit2(mask);
+        start = now();
+        Bit2Roar_T roar_and = Bit2Roar_and(roar, roar_mask);
+        double roar_op = now() - start;
+        assert(Bit2_popcount(dense_and) == Bit2Roar_popcount(roar_and));
+
+        printf("%d x %d page, %.2f%% ink, times in seconds, memory in bytes\n",
+               width, height, 100.0 * dense_ink / width / height);
+        printf("%-9s %12s %10s %10s %10s\n", "type", "memory", "set bits",
+               "gets", "and");
+        printf("%-9s %12zu %10.3f %10.3f %10.3f\n", "Bit2", dense_memory,
+               dense_scan, dense_get, dense_op);
+        printf("%-9s %12zu %10.3f %10.3f %10s\n", "Bit2RLE",
+               Bit2RLE_memory(rle), rle_scan, rle_get, "");
+        printf("%-9s %12zu %10.3f %10.3f %10.3f\n", "Bit2Roar",
+               Bit2Roar_memory(roar), roar_scan, roar_get, roar_op);
+
+        free(cols);
+        free(rows);
+        Bit2Roar_free(&roar_and);
+        Bit2Roar_free(&roar_mask);
+        Bit2Roar_free(&roar);
+        Bit2RLE_free(&rle);
+        Bit2_free(&dense_and);
+        Bit2_free(&mask);
+        Bit2_free(&page);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** draw_page ********
+ *
+ * Draws a page of mixed density inside 1200-pixel margins: a column of
+ * text-like glyphs down the left half, a photo of random noise in the top
+ * right quarter, and a solid bar across the bottom.
+ *
+ * Parameters:
+ *      Bit2_T page: the page to draw on
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void draw_page(Bit2_T page)
+{
+        int width = Bit2_width(page);
+        int height = Bit2_height(page);
+        int middle = width / 2;
+        unsigned seed = 1;
+        for (int top = 1200; top + 120 < height - 1800; top += 300) {
+                for (int left = 1200; left + 100 < middle - 200;
+                     left += 120) {
+                        seed = seed * 1103515245 + 12345;
+                        if ((seed >> 16) % 6 == 0) {
+                                continue;       /* a space */
+                        }
+                        fill(page, left, top, left + 12, top + 120);
+                        fill(page, left + 80, top, left + 92, top + 120);
+                        fill(page, left + 12, top + 55, left + 80, top + 67);
+                }
+        }
+
+        uint64_t x = 0x9e3779b97f4a7c15u;
+        int first = (middle + 64) / 64;
+        int last = (width - 1200) / 64;
+        for (int row = 1200; row < height / 2; row++) {
+                for (int word = first; word < last; word++) {
+                        x ^= x << 13;
+                        x ^= x >> 7;
+                        x ^= x << 17;
+                        Bit2_put_word(page, word, row, x);
+                }
+        }
+
+        if (height > 3000 && width > 2400) {
+                fill(page, 1200, height - 1500, width - 1200, height - 1300);
+        }
+}
+
+/********** fill ********
+ *
+ * Sets every bit of a rectangle, which is clipped to the page.
+ *
+ * Parameters:
+ *      Bit2_T page: the page to draw on
+ *      int left, int top: the top left corner of the rectangle
+ *      int right, int bottom: one past the bottom right corner
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void fill(Bit2_T page, int left, int top, int right, int bottom)
+{
+        if (right > Bit2_width(page)) {
+                right = Bit2_width(page);
+        }
+        if (bottom > Bit2_height(page)) {
+                bottom = Bit2_height(page);
+        }
+        for (int row = top; row < bottom; row++) {
+                for (int col = left; col < right; col++) {
+                        Bit2_put(page, col, row, 1);
+                }
+        }
+}
+
+/********** count_bit ********
+ *
+ * Set-bit map function that counts the bits visited in the long at cl.
+ ************************/
+static void count_bit(int col, int row, Bit2_T B2, void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)B2;
+        (*(long *)cl)++;
+}
+
+/********** count_roar ********
+ *
+ * Set-bit map function that counts the bits visited in the long at cl.
+ ************************/
+static void count_roar(int col, int row, Bit2Roar_T B, void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)B;
+        (*(long *)cl)++;
+}
+
+/********** count_run ********
+ *
+ * Run map function that adds the length of each run to the long at cl.
+ ************************/
+static void count_run(int row, int start, int length, void *cl)
+{
+        (void)row;
+        (void)start;
+        *(long *)cl += length;
+}
@@ -0,0 +1,151 @@
+/*******************************************************************************
+ *
+ *                     benchmorton.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing the UARRAY2_ROW_MAJOR and
+ *     UARRAY2_MORTON layouts of UArray2 on a mixed workload: a row-major pass
+ *     followed by a column-major pass over the same DIM x DIM grid of ints
+ *     (4096 x 4096 by default), the way rowcheck_sudoku and colcheck_sudoku
+ *     in sudoku.c scan the same array. Each pass is timed once through
+ *     UArray2_at loops and once through the map functions, and the Morton
+ *     array is also timed under UArray2_map_morton.
+ *     Usage: benchmorton [dim]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "uarray2.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void);
+static void run_layout(int dim, UArray2_layout layout, const char *name);
+static long scan_rows(UArray2_T U2);
+static long scan_cols(UArray2_T U2);
+static void sum_elem(int col, int row, UArray2_T U2, void *elem, void *cl);
+
+int main(int argc, char *argv[])
+{
+        assert(argc <= 2);
+        int dim = (argc == 2) ? atoi(argv[1]) : 4096;
+        assert(dim > 0);
+
+        printf("%d x %d ints, times in seconds\n", dim, dim);
+        printf("%-10s %9s %9s %9s %9s %9s %9s\n", "layout", "at rows",
+               "at cols", "at mixed", "map rows", "map cols", "map mixed");
+        run_layout(dim, UARRAY2_ROW_MAJOR, "row-major");
+        run_layout(dim, UARRAY2_MORTON, "morton");
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** run_layout ********
+ *
+ * Builds a DIM x DIM array in the given layout, times the mixed workload on
+ * it, and prints one row of results.
+ *
+ * Parameters:
+ *      int dim: the width and height of the array
+ *      UArray2_layout layout: the layout to benchmark
+ *      const char *name: the name to print for the layout
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void run_layout(int dim, UArray2_layout layout, const char *name)
+{
+        UArray2_T U2 = UArray2_new_layout(dim, dim, sizeof(int), layout);
+        for (int row = 0; row < dim; row++) {
+                for (int col = 0; col < dim; col++) {
+                        *(int *)UArray2_at(U2, col, row) = row ^ col;
+                }
+        }
+
+        double start = now();
+        long row_sum = scan_rows(U2);
+        double at_rows = now() - start;
+        start = now();
+        long col_sum = scan_cols(U2);
+        double at_cols = now() - start;
+        assert(row_sum == col_sum);
+
+        long map_row_sum = 0;
+        start = now();
+        UArray2_map_row_major(U2, sum_elem, &map_row_sum);
+        double map_rows = now() - start;
+        long map_col_sum = 0;
+        start = now();
+        UArray2_map_col_major(U2, sum_elem, &map_col_sum);
+        double map_cols = now() - start;
+        assert(map_row_sum == row_sum && map_col_sum == row_sum);
+
+        printf("%-10s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, at_rows,
+               at_cols, at_rows + at_cols, map_rows, map_cols,
+               map_rows + map_cols);
+
+        if (layout == UARRAY2_MORTON) {
+                long z_sum = 0;
+                start = now();
+                UArray2_map_morton(U2, sum_elem, &z_sum);
+                assert(z_sum == row_sum);
+                printf("UArray2_map_morton: %.3f\n", now() - start);
+        }
+        UArray2_free(&U2);
+}
+
+/********** scan_rows ********
+ *
+ * Sums the array in row-major order through UArray2_at.
+ ************************/
+static long scan_rows(UArray2_T U2)
+{
+        long sum = 0;
+        for (int row = 0; row < UArray2_height(U2); row++) {
+                for (int col = 0; col < UArray2_width(U2); col++) {
+                        sum += *(int *)UArray2_at(U2, col, row);
+                }
+        }
+        return sum;
+}
+
+/********** scan_cols ********
+ *
+ * Sums the array in column-major order through UArray2_at.
+ ************************/
+static long scan_cols(UArray2_T U2)
+{
+        long sum = 0;
+        for (int col = 0; col < UArray2_width(U2); col++) {
+                for (int row = 0; row < UArray2_height(U2); row++) {
+                        sum += *(int *)UArray2_at(U2, col, row);
+                }
+        }
+        return sum;
+}
+
+/********** sum_elem ********
+ *
+ * Map function that adds an int element to the long pointed to by cl.
+ ************************/
+static void sum_elem(int col, int row, UArray2_T U2, void *elem, void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)U2;
+        *(long *)cl += *(int *)elem;
+}
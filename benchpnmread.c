@@ -0,0 +1,266 @@
+/*******************************************************************************
+ *
+ *                     benchpnmread.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing the course's Pnmrdr against
+ *     our Pnmread on plain (ASCII) input, which is where reading costs the
+ *     most. It writes a plain bitmap (P1) and a plain graymap (P2) of about
+ *     MEGABYTES megabytes each (100 by default) to temporary files, then
+ *     reads each one back both ways: with Pnmrdr, one Pnmrdr_get per pixel,
+ *     packing bitmap pixels into Bit2 words as unblackedges does, and with
+ *     Pnmread, one Pnmread_bits or Pnmread_values call per row. Both ways
+ *     must agree. For each it prints the time and the rate in megabytes
+ *     per second.
+ *     Usage: benchpnmread [megabytes]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "pnmread.h"
+#include "bit2.h"
+#include "assert.h"
+#include "pnmrdr.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define WIDTH 5000
+
+static double now(void);
+static FILE *write_bitmap(long megabytes, int *height, long *bytes);
+static FILE *write_graymap(long megabytes, int *height, long *bytes);
+static void run_bitmap(FILE *fp, int height, long bytes);
+static void run_graymap(FILE *fp, int height, long bytes);
+static void print_result(const char *type, const char *reader, double time,
+                         long bytes);
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1 || argc == 2);
+        long megabytes = (argc == 2) ? atol(argv[1]) : 100;
+        assert(megabytes > 0);
+
+        printf("plain input, %d pixels wide, times in seconds\n", WIDTH);
+        printf("%-4s %-8s %10s %10s %10s\n", "type", "reader", "megabytes",
+               "time", "MB/s");
+
+        int height;
+        long bytes;
+        FILE *fp = write_bitmap(megabytes, &height, &bytes);
+        run_bitmap(fp, height, bytes);
+        fclose(fp);
+
+        fp = write_graymap(megabytes, &height, &bytes);
+        run_graymap(fp, height, bytes);
+        fclose(fp);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** write_bitmap ********
+ *
+ * Writes a plain bitmap of random pixels, WIDTH wide and about megabytes
+ * megabytes long, to a temporary file.
+ *
+ * Parameters:
+ *      long megabytes: the size to aim for
+ *      int *height: where to store the height of the bitmap
+ *      long *bytes: where to store the size of the file
+ *
+ * Return: the file, which the caller closes
+ *
+ * Notes:
+ *      Each pixel is a digit and a space, and each row ends in a newline,
+ *      with a comment every hundred rows.
+ ************************/
+static FILE *write_bitmap(long megabytes, int *height, long *bytes)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        *height = megabytes * 1000000 / (2 * WIDTH);
+        fprintf(fp, "P1\n%d %d\n", WIDTH, *height);
+        uint32_t state = 1;
+        for (int row = 0; row < *height; row++) {
+                if (row % 100 == 0) {
+                        fprintf(fp, "# row %d\n", row);
+                }
+                for (int col = 0; col < WIDTH; col++) {
+                        state = state * 1103515245 + 12345;
+                        putc('0' + (state >> 31), fp);
+                        putc(col == WIDTH - 1 ? '\n' : ' ', fp);
+                }
+        }
+        assert(fflush(fp) == 0);
+        *bytes = ftell(fp);
+        return fp;
+}
+
+/********** write_graymap ********
+ *
+ * Writes a plain graymap of random values from 0 to 255, WIDTH wide and
+ * about megabytes megabytes long, to a temporary file.
+ *
+ * Parameters:
+ *      long megabytes: the size to aim for
+ *      int *height: where to store the height of the graymap
+ *      long *bytes: where to store the size of the file
+ *
+ * Return: the file, which the caller closes
+ ************************/
+static FILE *write_graymap(long megabytes, int *height, long *bytes)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        /* values of 0 to 255 average about 3.6 characters with a space */
+        *height = megabytes * 1000000 / (3.6 * WIDTH);
+        fprintf(fp, "P2\n%d %d\n255\n", WIDTH, *height);
+        uint32_t state = 1;
+        for (int row = 0; row < *height; row++) {
+                for (int col = 0; col < WIDTH; col++) {
+                        state = state * 1103515245 + 12345;
+                        fprintf(fp, "%u%c", state >> 24,
+                                col == WIDTH - 1 ? '\n' : ' ');
+                }
+        }
+        assert(fflush(fp) == 0);
+        *bytes = ftell(fp);
+        return fp;
+}
+
+/********** run_bitmap ********
+ *
+ * Reads a plain bitmap into a Bit2 with each reader, checks that they agree,
+ * and prints one row of results for each.
+ *
+ * Parameters:
+ *      FILE *fp: the bitmap, as written by write_bitmap
+ *      int height: its height
+ *      long bytes: its size
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void run_bitmap(FILE *fp, int height, long bytes)
+{
+        Bit2_T slow = Bit2_new(WIDTH, height);
+        Bit2_T fast = Bit2_new(WIDTH, height);
+
+        rewind(fp);
+        double start = now();
+        Pnmrdr_T rdr = Pnmrdr_new(fp);
+        for (int row = 0; row < height; row++) {
+                uint64_t word = 0;
+                for (int col = 0; col < WIDTH; col++) {
+                        word |= (uint64_t)Pnmrdr_get(rdr) << (col % 64);
+                        if (col % 64 == 63 || col == WIDTH - 1) {
+                                Bit2_put_word(slow, col / 64, row, word);
+                                word = 0;
+                        }
+                }
+        }
+        Pnmrdr_free(&rdr);
+        print_result("P1", "Pnmrdr", now() - start, bytes);
+
+        rewind(fp);
+        start = now();
+        Pnmread_T reader = Pnmread_new(fp);
+        for (int row = 0; row < height; row++) {
+                Pnmread_bits(reader, fast, row);
+        }
+        Pnmread_free(&reader);
+        print_result("P1", "Pnmread", now() - start, bytes);
+
+        for (int row = 0; row < height; row++) {
+                for (int w = 0; w < Bit2_words_per_row(fast); w++) {
+                        assert(Bit2_get_word(slow, w, row) ==
+                               Bit2_get_word(fast, w, row));
+                }
+        }
+        Bit2_free(&slow);
+        Bit2_free(&fast);
+}
+
+/********** run_graymap ********
+ *
+ * Reads a plain graymap a row at a time with each reader, checks that they
+ * agree, and prints one row of results for each.
+ *
+ * Parameters:
+ *      FILE *fp: the graymap, as written by write_graymap
+ *      int height: its height
+ *      long bytes: its size
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      The readers agree if the rows they read have the same checksum.
+ ************************/
+static void run_graymap(FILE *fp, int height, long bytes)
+{
+        unsigned *values = malloc(WIDTH * sizeof(*values));
+        assert(values != NULL);
+
+        rewind(fp);
+        double start = now();
+        uint64_t slow_sum = 0;
+        Pnmrdr_T rdr = Pnmrdr_new(fp);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < WIDTH; col++) {
+                        values[col] = Pnmrdr_get(rdr);
+                }
+                for (int col = 0; col < WIDTH; col++) {
+                        slow_sum = slow_sum * 31 + values[col];
+                }
+        }
+        Pnmrdr_free(&rdr);
+        print_result("P2", "Pnmrdr", now() - start, bytes);
+
+        rewind(fp);
+        start = now();
+        uint64_t fast_sum = 0;
+        Pnmread_T reader = Pnmread_new(fp);
+        for (int row = 0; row < height; row++) {
+                Pnmread_values(reader, values, WIDTH);
+                for (int col = 0; col < WIDTH; col++) {
+                        fast_sum = fast_sum * 31 + values[col];
+                }
+        }
+        Pnmread_free(&reader);
+        print_result("P2", "Pnmread", now() - start, bytes);
+
+        assert(slow_sum == fast_sum);
+        free(values);
+}
+
+/********** print_result ********
+ *
+ * Prints one row of results.
+ *
+ * Parameters:
+ *      const char *type: the magic number of the input
+ *      const char *reader: the name of the reader
+ *      double time: the time it took, in seconds
+ *      long bytes: the size of the input
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void print_result(const char *type, const char *reader, double time,
+                         long bytes)
+{
+        printf("%-4s %-8s %10.1f %10.3f %10.1f\n", type, reader, bytes / 1e6,
+               time, bytes / 1e6 / time);
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ *
+ *                     benchuarray2.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing the checked UArray2_at accessor
+ *     against the unchecked UArray2_raw_at fast path. It runs the same row,
+ *     column, and 3x3 submap scans that sudoku.c performs, once through each
+ *     accessor, and prints the time taken by each along with the speedup.
+ *     Usage: benchuarray2 [repetitions]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "uarray2.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void);
+static void fill_solution(UArray2_T U2);
+static int scan_checked(UArray2_T U2);
+static int scan_raw(UArray2_T U2);
+
+int main(int argc, char *argv[])
+{
+        assert(argc <= 2);
+        long reps = (argc == 2) ? atol(argv[1]) : 2000000;
+        assert(reps > 0);
+
+        UArray2_T sudoku = UArray2_new(9, 9, sizeof(unsigned));
+        fill_solution(sudoku);
+
+        /* both scans must agree on every grid they see */
+        assert(scan_checked(sudoku) == scan_raw(sudoku));
+
+        long bad = 0;
+        double start = now();
+        for (long i = 0; i < reps; i++) {
+                bad += scan_checked(sudoku);
+        }
+        double checked = now() - start;
+
+        start = now();
+        for (long i = 0; i < reps; i++) {
+                bad += scan_raw(sudoku);
+        }
+        double raw = now() - start;
+
+        printf("%ld sudoku scans (%ld bad)\n", reps, bad);
+        printf("UArray2_at:     %8.3f s\n", checked);
+        printf("UArray2_raw_at: %8.3f s\n", raw);
+        printf("speedup:        %8.2fx\n", checked / raw);
+
+        UArray2_free(&sudoku);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** fill_solution ********
+ *
+ * Fills a 9x9 UArray2 of unsigned with a valid sudoku solution.
+ *
+ * Parameters:
+ *      UArray2_T U2: a 9x9 UArray2_T of unsigned
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void fill_solution(UArray2_T U2)
+{
+        for (int row = 0; row < 9; row++) {
+                for (int col = 0; col < 9; col++) {
+                        unsigned *n = UArray2_at(U2, col, row);
+                        *n = (3 * (row % 3) + row / 3 + col) % 9 + 1;
+                }
+        }
+}
+
+/********** scan_checked ********
+ *
+ * Runs the sudoku.c row, column, and submap checks through UArray2_at.
+ *
+ * Parameters:
+ *      UArray2_T U2: a 9x9 UArray2_T of unsigned
+ *
+ * Return: The number of rows, columns, and submaps that fail the check.
+ ************************/
+static int scan_checked(UArray2_T U2)
+{
+        int bad = 0;
+        for (int i = 0; i < 9; i++) {
+                int in_row[10] = {0};
+                int in_col[10] = {0};
+                int in_box[10] = {0};
+                for (int j = 0; j < 9; j++) {
+                        unsigned r = *(unsigned *)UArray2_at(U2, j, i);
+                        unsigned c = *(unsigned *)UArray2_at(U2, i, j);
+                        unsigned b = *(unsigned *)UArray2_at(U2,
+                                        (i % 3) * 3 + j % 3,
+                                        (i / 3) * 3 + j / 3);
+                        bad += in_row[r]++ + in_col[c]++ + in_box[b]++;
+                }
+        }
+        return bad;
+}
+
+/********** scan_raw ********
+ *
+ * Runs the same checks as scan_checked through UArray2_raw_at.
+ *
+ * Parameters:
+ *      UArray2_T U2: a 9x9 UArray2_T of unsigned
+ *
+ * Return: The number of rows, columns, and submaps that fail the check.
+ ************************/
+static int scan_raw(UArray2_T U2)
+{
+        UArray2_rawdata R = UArray2_raw(U2);
+        int bad = 0;
+        for (int i = 0; i < 9; i++) {
+                int in_row[10] = {0};
+                int in_col[10] = {0};
+                int in_box[10] = {0};
+                for (int j = 0; j < 9; j++) {
+                        unsigned r = *(unsigned *)UArray2_raw_at(R, j, i);
+                        unsigned c = *(unsigned *)UArray2_raw_at(R, i, j);
+                        unsigned b = *(unsigned *)UArray2_raw_at(R,
+                                        (i % 3) * 3 + j % 3,
+                                        (i / 3) * 3 + j / 3);
+                        bad += in_row[r]++ + in_col[c]++ + in_box[b]++;
+                }
+        }
+        return bad;
+}
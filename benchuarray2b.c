@@ -0,0 +1,114 @@
+/*******************************************************************************
+ *
+ *                     benchuarray2b.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides a benchmark comparing column-major traversal of the
+ *     flat UArray2 against the blocked UArray2b. It times
+ *     UArray2_map_col_major, UArray2b_map_col_major, and
+ *     UArray2b_map_block_major over a DIM x DIM grid of ints (8192 x 8192
+ *     by default), and prints the time taken by each.
+ *     Usage: benchuarray2b [dim [blocksize]]
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 199309L
+
+#include "uarray2.h"
+#include "uarray2b.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void);
+static void sum_flat(int col, int row, UArray2_T U2, void *elem, void *cl);
+static void sum_blocked(int col, int row, UArray2b_T U2b, void *elem,
+                        void *cl);
+
+int main(int argc, char *argv[])
+{
+        assert(argc <= 3);
+        int dim = (argc >= 2) ? atoi(argv[1]) : 8192;
+        assert(dim > 0);
+
+        /* fill each cell with its row so that the sums can be compared */
+        UArray2_T flat = UArray2_new(dim, dim, sizeof(int));
+        for (int row = 0; row < dim; row++) {
+                for (int col = 0; col < dim; col++) {
+                        *(int *)UArray2_at(flat, col, row) = row;
+                }
+        }
+        long flat_sum = 0;
+        double start = now();
+        UArray2_map_col_major(flat, sum_flat, &flat_sum);
+        double flat_col = now() - start;
+        UArray2_free(&flat);
+
+        UArray2b_T blocked = (argc == 3)
+                ? UArray2b_new(dim, dim, sizeof(int), atoi(argv[2]))
+                : UArray2b_new_64K_block(dim, dim, sizeof(int));
+        for (int row = 0; row < dim; row++) {
+                for (int col = 0; col < dim; col++) {
+                        *(int *)UArray2b_at(blocked, col, row) = row;
+                }
+        }
+        long col_sum = 0;
+        start = now();
+        UArray2b_map_col_major(blocked, sum_blocked, &col_sum);
+        double blocked_col = now() - start;
+
+        long block_sum = 0;
+        start = now();
+        UArray2b_map_block_major(blocked, sum_blocked, &block_sum);
+        double blocked_block = now() - start;
+
+        assert(flat_sum == col_sum && col_sum == block_sum);
+
+        printf("%d x %d ints, blocksize %d\n", dim, dim,
+               UArray2b_blocksize(blocked));
+        printf("UArray2_map_col_major:    %8.3f s\n", flat_col);
+        printf("UArray2b_map_col_major:   %8.3f s\n", blocked_col);
+        printf("UArray2b_map_block_major: %8.3f s\n", blocked_block);
+
+        UArray2b_free(&blocked);
+        return EXIT_SUCCESS;
+}
+
+/********** now ********
+ *
+ * Returns the current value of the monotonic clock in seconds.
+ ************************/
+static double now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/********** sum_flat ********
+ *
+ * Map function that adds an int element to the long pointed to by cl.
+ ************************/
+static void sum_flat(int col, int row, UArray2_T U2, void *elem, void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)U2;
+        *(long *)cl += *(int *)elem;
+}
+
+/********** sum_blocked ********
+ *
+ * Map function that adds an int element to the long pointed to by cl.
+ ************************/
+static void sum_blocked(int col, int row, UArray2b_T U2b, void *elem,
+                        void *cl)
+{
+        (void)col;
+        (void)row;
+        (void)U2b;
+        *(long *)cl += *(int *)elem;
+}
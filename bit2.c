@@ -6,25 +6,116 @@
  *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
  *     Date:     9/28/23
  *
- *     This file contains the implementation of the Bit2 data structure. The 
- *     Bit2 relies on Hanson's Bit data structure. It represents a 2-dimensional
- *     array of bits by using a single 1-demnsional array where the first WIDTH
- *     elements in the 1D array represent the first column in the 2D array, etc.
+ *     This file contains the implementation of the Bit2 data structure. It 
+ *     represents a 2-dimensional array of bits by using a single 1-dimensional
+ *     array of 64-bit words stored row by row. Each row starts on a fresh word,
+ *     so a row is always a contiguous run of WORDS_PER_ROW words that can be
+ *     handed to a client as-is. Within a row, the bit for column col is bit
+ *     (col % 64) of word (col / 64); the bits past the width in the last word
+ *     of a row are always zero.
+ *
+ *     Hanson's Bit_T keeps its words private, so we manage the words here
+ *     rather than wrapping a Bit_T.
+ *
+ *     Dimensions and word indices are kept in size_t, and the number of words
+ *     is computed with overflow checks, so that Bit2_new64, Bit2_get64, and
+ *     Bit2_put64 can handle images with more than INT_MAX pixels.
+ *
+ *     The words normally come from the heap. A Bit2 loaded with 
+ *     Bit2_load_mapped instead uses the payload of a snapshot file mapped in
+ *     place, which holds the words exactly as they would sit in memory, and
+ *     a Bit2 created with Bit2_new_in keeps its handle and words together in
+ *     one allocation from an arena.
+ *
+ *     A Bit2 made by Bit2_wrap_buffer is a view: it has no words of its own,
+ *     but reads and writes the client's bytes, whose rows are row_stride 
+ *     bytes apart and start on a fresh byte, with the pixels of each byte in
+ *     either bit order. Single bits are found in their byte directly. 
+ *     Functions that work on words assemble each word from (or scatter it 
+ *     back into) up to 8 bytes, reversing the bits of every byte for an 
+ *     MSB-first buffer, and clear the bits past the width, since the padding
+ *     bits of a client's buffer need not be zero. The padding bits in the 
+ *     buffer itself are never changed.
+ *
+ *     The bulk operations (Bit2_and, Bit2_or, Bit2_xor, Bit2_andnot, 
+ *     Bit2_not, and Bit2_popcount) treat the words of a whole grid as one 
+ *     flat array, padding included, since the padding is zero in every Bit2.
+ *     On x86 they use AVX2 kernels when the processor supports them, chosen 
+ *     at run time, and SSE2 or plain 64-bit kernels otherwise.
  *
  ******************************************************************************/
 #include "bit2.h"
-#include "bit.h"
+#include "snapshot.h"
 #include "except.h"
 #include "assert.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIT2_X86 1
+#include <immintrin.h>
+#endif
+
+#define BITS_PER_WORD 64
+
+static const char SNAPSHOT_MAGIC[8] = {
+        'B', 'I', 'T', '2', 'S', 'N', 'A', 'P'
+};
 
 struct Bit2_T {
-        int width;
-        int height;
-        Bit_T B_internal;
+        size_t width;
+        size_t height;
+        size_t words_per_row;
+        uint64_t *words;
+        enum { 
+                STORAGE_HEAP, STORAGE_SNAPSHOT, STORAGE_ARENA, STORAGE_VIEW
+        } storage;
+        unsigned char *bytes;   /* the client's buffer, for a view */
+        size_t row_stride;      /* bytes from one row to the next, for a view */
+        int msb_first;          /* 1 if a view is in BIT2_MSB_FIRST order */
 };
 
+static size_t mul_checked(size_t a, size_t b);
+static size_t set_shape(Bit2_T B2, size_t width, size_t height);
+static void assert_int_dims(Bit2_T B2);
+static uint64_t load_word(Bit2_T B2, size_t word_col, size_t row);
+static void store_word(Bit2_T B2, size_t word_col, size_t row, 
+                       uint64_t word);
+static uint64_t view_load(Bit2_T B2, size_t word_col, size_t row);
+static void view_store(Bit2_T B2, size_t word_col, size_t row, 
+                       uint64_t word);
+static uint64_t reverse_byte_bits(uint64_t word);
+static const uint64_t *row_words(Bit2_T B2, size_t row, uint64_t *scratch);
+static size_t run_start(Bit2_T B2, size_t row, size_t col);
+static size_t run_end(Bit2_T B2, size_t row, size_t col);
+static size_t next_set(Bit2_T B2, size_t row, size_t col, size_t last);
+static void clear_run(Bit2_T B2, size_t row, size_t first, size_t last);
+static void push_runs(Bit2_T B2, size_t row, size_t first, size_t last, 
+                      uint64_t **stack, size_t *count, size_t *capacity);
+static int spread_row(Bit2_T reach, Bit2_T mask, size_t row, size_t from, 
+                      size_t lo, size_t hi, int whole, size_t *changed_lo, 
+                      size_t *changed_hi);
+static uint64_t fill_up(uint64_t x, uint64_t m);
+static uint64_t fill_down(uint64_t x, uint64_t m);
+
+typedef enum { OP_AND, OP_OR, OP_XOR, OP_ANDNOT, OP_NOT } bulk_op;
+
+static void assert_same_shape(Bit2_T a, Bit2_T b);
+static void combine_grids(Bit2_T dst, Bit2_T a, Bit2_T b, bulk_op op);
+static void combine_words(uint64_t *dst, const uint64_t *a, 
+                          const uint64_t *b, size_t n, bulk_op op);
+static void combine_scalar(uint64_t *dst, const uint64_t *a, 
+                           const uint64_t *b, size_t n, bulk_op op);
+static size_t count_words(const uint64_t *words, size_t n);
+static size_t count_scalar(const uint64_t *words, size_t n);
+#if defined(BIT2_X86)
+static void combine_avx2(uint64_t *dst, const uint64_t *a, 
+                         const uint64_t *b, size_t n, bulk_op op);
+static size_t count_avx2(const uint64_t *words, size_t n);
+static size_t count_popcnt(const uint64_t *words, size_t n);
+#endif
+
 /********** Bit2_new ********
  *
  * Allocates, initializes, and returns a new Bit2_T.
@@ -41,19 +132,136 @@ struct Bit2_T {
  * Notes:
  *      will call a CRE if the above expectations are not met
  *      the memory associated with B2 is freed using Bit2_free
- *      a Bit_T struct is initialized internally as part of the Bit2_T struct
+ *      every bit starts out as 0
  ************************/
 Bit2_T Bit2_new(int width, int height) {
         assert(width >= 0);
         assert(height >= 0);
+        return Bit2_new64(width, height);
+}
 
-        Bit_T B = Bit_new(width * height);
-        Bit2_T B2 = malloc(16);
+/********** Bit2_new64 ********
+ *
+ * Allocates, initializes, and returns a new Bit2_T whose number of bits may
+ * exceed INT_MAX.
+ *
+ * Parameters:
+ *      size_t width:  the width of the Bit2_T
+ *      size_t height: the height of the Bit2_T
+ *
+ * Return: Returns the newly created Bit2_T struct.
+ *
+ * Expects
+ *      the number of bytes needed does not overflow a size_t
+ *      the memory can be allocated
+ * Notes:
+ *      will call a CRE if the above expectations are not met
+ *      the memory associated with B2 is freed using Bit2_free
+ *      every bit starts out as 0
+ *      the int interface may still be used as long as the width and height
+ *      each fit in an int
+ ************************/
+Bit2_T Bit2_new64(size_t width, size_t height) {
+        Bit2_T B2 = malloc(sizeof(*B2));
         assert(B2 != NULL);
 
-        B2->width = width;
-        B2->height = height;
-        B2->B_internal = B;
+        size_t nwords = set_shape(B2, width, height);
+        mul_checked(nwords + 1, sizeof(uint64_t));
+        /* one spare word so that an empty Bit2 still gets an allocation */
+        B2->words = calloc(nwords + 1, sizeof(uint64_t));
+        assert(B2->words != NULL);
+        B2->storage = STORAGE_HEAP;
+        return B2;
+}
+
+/********** Bit2_new_in ********
+ *
+ * Allocates, initializes, and returns a new Bit2_T whose handle and words 
+ * both come from an arena.
+ *
+ * Parameters:
+ *      UArray2_Arena_T arena: the arena to allocate from
+ *      int width:  an integer for the width of the Bit2_T
+ *      int height: an integer for the height of the Bit2_T
+ *
+ * Return: Returns the newly created Bit2_T struct.
+ *
+ * Expects
+ *      arena is not NULL
+ *      width and height are non-negative
+ * Notes:
+ *      will call a CRE if the above expectations are not met
+ *      every bit starts out as 0
+ *      the handle and the words are one allocation from the arena, which 
+ *      releases them when it is reset or freed; Bit2_free releases nothing
+ ************************/
+Bit2_T Bit2_new_in(UArray2_Arena_T arena, int width, int height) {
+        assert(arena != NULL);
+        assert(width >= 0);
+        assert(height >= 0);
+
+        struct Bit2_T shape;
+        size_t nwords = set_shape(&shape, width, height);
+
+        /* the words follow the handle, rounded up to a whole word */
+        size_t handle = (sizeof(shape) + sizeof(uint64_t) - 1) / 
+                        sizeof(uint64_t) * sizeof(uint64_t);
+        size_t bytes = mul_checked(nwords, sizeof(uint64_t));
+        assert(bytes <= SIZE_MAX - handle);
+        char *block = UArray2_Arena_alloc(arena, handle + bytes);
+
+        Bit2_T B2 = (Bit2_T)block;
+        *B2 = shape;
+        B2->words = (uint64_t *)(block + handle);
+        B2->storage = STORAGE_ARENA;
+        return B2;
+}
+
+/********** Bit2_wrap_buffer ********
+ *
+ * Returns a new Bit2_T that is a view of bits already in memory, such as the
+ * payload of a raw (P4) pbm.
+ *
+ * Parameters:
+ *      void *bytes: the first byte of the first row
+ *      int width:  an integer for the width of the Bit2_T
+ *      int height: an integer for the height of the Bit2_T
+ *      size_t row_stride: the number of bytes from the start of one row to 
+ *      the start of the next
+ *      Bit2_bit_order order: BIT2_MSB_FIRST if the first pixel of each byte
+ *      is its high bit, as in a P4 pbm, or BIT2_LSB_FIRST if it is bit 0
+ *
+ * Return: Returns the newly created Bit2_T struct.
+ *
+ * Expects
+ *      bytes is not NULL
+ *      width and height are non-negative
+ *      row_stride is at least the width divided by 8, rounded up
+ *      the buffer holds height rows and outlives the Bit2_T
+ * Notes:
+ *      will call a CRE if any of the above expectations that can be checked
+ *      are not met
+ *      nothing is copied: gets read the buffer and puts write it
+ *      Bit2_free frees only the handle; the buffer belongs to the client
+ *      the bits past the width in the last byte of each row are ignored, and
+ *      are never changed
+ ************************/
+Bit2_T Bit2_wrap_buffer(void *bytes, int width, int height, 
+                        size_t row_stride, Bit2_bit_order order) {
+        assert(bytes != NULL);
+        assert(width >= 0);
+        assert(height >= 0);
+        assert(row_stride >= (size_t)width / 8 + (width % 8 != 0));
+        assert(order == BIT2_LSB_FIRST || order == BIT2_MSB_FIRST);
+
+        Bit2_T B2 = malloc(sizeof(*B2));
+        assert(B2 != NULL);
+        set_shape(B2, width, height);
+        B2->words = NULL;
+        B2->storage = STORAGE_VIEW;
+        B2->bytes = bytes;
+        B2->row_stride = row_stride;
+        B2->msb_first = (order == BIT2_MSB_FIRST);
         return B2;
 }
 
@@ -68,12 +276,14 @@ Bit2_T Bit2_new(int width, int height) {
  *
  * Expects
  *      B2 to not be NULL
+ *      the width fits in an int (use Bit2_width64 otherwise)
  * Notes:
  *      Will call a CRE if the above expectations are not met.
  ************************/
 int Bit2_width(Bit2_T B2) {
         assert(B2 != NULL);
-        return B2->width;
+        assert(B2->width <= INT_MAX);
+        return (int)B2->width;
 }
 
 /********** Bit2_height ********
@@ -87,12 +297,14 @@ int Bit2_width(Bit2_T B2) {
  *
  * Expects
  *      B2 to not be NULL.
+ *      the height fits in an int (use Bit2_height64 otherwise)
  * Notes:
  *      Will call a CRE if the above expectations are not met.
  ************************/
 int Bit2_height(Bit2_T B2) {
         assert(B2 != NULL);
-        return B2->height;
+        assert(B2->height <= INT_MAX);
+        return (int)B2->height;
 }
 
 /********** Bit2_get ********
@@ -113,17 +325,12 @@ int Bit2_height(Bit2_T B2) {
  *      row is less than the height of the Bit2_T struct
  * Notes:
  *      calls a CRE if any of the above expectations are not met
- *      finds the index in the underlying array using the formula 
- *              (col * width) + row
+ *      checks the signs of col and row, then defers to Bit2_get64
  ************************/
 int Bit2_get(Bit2_T B2, int col, int row) {
-        assert(B2 != NULL);
         assert(col >= 0);
         assert(row >= 0);
-        assert(col < B2->width);
-        assert(row < B2->height);
-        
-        return Bit_get(B2->B_internal, ((col * B2->width) + row));
+        return Bit2_get64(B2, col, row);
 }
 
 /********** Bit2_put ********
@@ -147,18 +354,216 @@ int Bit2_get(Bit2_T B2, int col, int row) {
  *      the bit value to be inserted is either 0 or 1
  * Notes:
  *      calls a CRE if any of the above expectations are not met
- *      finds the index in the underlying array using the formula 
- *              (col * width) + row
+ *      checks the signs of col and row, then defers to Bit2_put64
  ************************/
 int Bit2_put(Bit2_T B2, int col, int row, int bit) {
-        assert(B2 != NULL);
         assert(col >= 0);
         assert(row >= 0);
+        return Bit2_put64(B2, col, row, bit);
+}
+
+/********** Bit2_width64 ********
+ *
+ * Returns the width of the Bit2_T struct as a size_t.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: Returns the width of the Bit2_T struct.
+ *
+ * Expects
+ *      B2 to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+size_t Bit2_width64(Bit2_T B2) {
+        assert(B2 != NULL);
+        return B2->width;
+}
+
+/********** Bit2_height64 ********
+ *
+ * Returns the height of the Bit2_T struct as a size_t.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: Returns the height of the Bit2_T struct.
+ *
+ * Expects
+ *      B2 to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+size_t Bit2_height64(Bit2_T B2) {
+        assert(B2 != NULL);
+        return B2->height;
+}
+
+/********** Bit2_get64 ********
+ *
+ * Returns the value of the bit at the given index, using size_t indices.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      size_t col: the column of the index of the bit
+ *      size_t row: the row of the index of the bit
+ *
+ * Return: The value of the bit at the given index in the Bit2_T struct.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      col is less than the width of the Bit2_T struct
+ *      row is less than the height of the Bit2_T struct
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      finds the bit at position (col % 64) of word 
+ *              (row * words_per_row) + (col / 64)
+ ************************/
+int Bit2_get64(Bit2_T B2, size_t col, size_t row) {
+        assert(B2 != NULL);
+        assert(col < B2->width);
+        assert(row < B2->height);
+
+        if (B2->storage == STORAGE_VIEW) {
+                unsigned char byte = B2->bytes[row * B2->row_stride + col / 8];
+                return (byte >> (B2->msb_first ? 7 - col % 8 : col % 8)) & 1;
+        }
+        uint64_t word = B2->words[row * B2->words_per_row + 
+                                  col / BITS_PER_WORD];
+        return (word >> (col % BITS_PER_WORD)) & 1;
+}
+
+/********** Bit2_put64 ********
+ *
+ * Inserts the given value at the index, using size_t indices, and returns the
+ * previous value.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      size_t col: the column of the index of the bit
+ *      size_t row: the row of the index of the bit
+ *      int bit: the value that is to be inserted
+ *
+ * Return: The value of the previous bit at the given index.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      col is less than the width of the Bit2_T struct
+ *      row is less than the height of the Bit2_T struct
+ *      the bit value to be inserted is either 0 or 1
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ ************************/
+int Bit2_put64(Bit2_T B2, size_t col, size_t row, int bit) {
+        assert(B2 != NULL);
         assert(col < B2->width);
         assert(row < B2->height);
         assert(bit == 1 || bit == 0);
-        
-        return Bit_put(B2->B_internal, ((col * B2->width) + row), bit);
+
+        if (B2->storage == STORAGE_VIEW) {
+                unsigned char *byte = &B2->bytes[row * B2->row_stride + 
+                                                 col / 8];
+                unsigned char mask = 1 << (B2->msb_first ? 7 - col % 8 
+                                                         : col % 8);
+                int prev = (*byte & mask) != 0;
+                *byte = bit ? (*byte | mask) : (*byte & ~mask);
+                return prev;
+        }
+        uint64_t *word = &B2->words[row * B2->words_per_row + 
+                                    col / BITS_PER_WORD];
+        uint64_t mask = (uint64_t)1 << (col % BITS_PER_WORD);
+        int prev = (*word & mask) != 0;
+        if (bit == 1) {
+                *word |= mask;
+        } else {
+                *word &= ~mask;
+        }
+        return prev;
+}
+
+/********** Bit2_words_per_row ********
+ *
+ * Returns the number of 64-bit words that hold each row of the Bit2_T.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: The number of words per row, which is the width divided by 64, 
+ *         rounded up.
+ *
+ * Expects
+ *      B2 to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+int Bit2_words_per_row(Bit2_T B2) {
+        assert(B2 != NULL);
+        assert(B2->words_per_row <= INT_MAX);
+        return (int)B2->words_per_row;
+}
+
+/********** Bit2_get_word ********
+ *
+ * Returns 64 bits of a row at once.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int word_col: which word of the row to get; word word_col holds 
+ *      columns 64 * word_col through 64 * word_col + 63
+ *      int row: the row of the word
+ *
+ * Return: The word, with the bit for column 64 * word_col + i in bit i.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      word_col is non-negative and less than Bit2_words_per_row
+ *      row is non-negative and less than the height of the Bit2_T struct
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      bits past the width in the last word of a row are always 0
+ ************************/
+uint64_t Bit2_get_word(Bit2_T B2, int word_col, int row) {
+        assert(B2 != NULL);
+        assert(word_col >= 0 && (size_t)word_col < B2->words_per_row);
+        assert(row >= 0 && (size_t)row < B2->height);
+        return load_word(B2, word_col, row);
+}
+
+/********** Bit2_put_word ********
+ *
+ * Replaces 64 bits of a row at once and returns the previous word.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int word_col: which word of the row to replace, as for Bit2_get_word
+ *      int row: the row of the word
+ *      uint64_t word: the new bits, with the bit for column 
+ *      64 * word_col + i in bit i
+ *
+ * Return: The previous value of the word.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      word_col is non-negative and less than Bit2_words_per_row
+ *      row is non-negative and less than the height of the Bit2_T struct
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      bits of word that fall past the width of the Bit2_T are ignored, so
+ *      that they stay 0
+ ************************/
+uint64_t Bit2_put_word(Bit2_T B2, int word_col, int row, uint64_t word) {
+        assert(B2 != NULL);
+        assert(word_col >= 0 && (size_t)word_col < B2->words_per_row);
+        assert(row >= 0 && (size_t)row < B2->height);
+
+        size_t tail = B2->width % BITS_PER_WORD;
+        if (tail != 0 && (size_t)word_col == B2->words_per_row - 1) {
+                word &= ((uint64_t)1 << tail) - 1;
+        }
+        uint64_t prev = load_word(B2, word_col, row);
+        store_word(B2, word_col, row, word);
+        return prev;
 }
 
 /********** Bit2_map_col_major ********
@@ -176,6 +581,7 @@ int Bit2_put(Bit2_T B2, int col, int row, int bit) {
  *
  * Expects
  *      B2 is not NULL
+ *      the width and height each fit in an int
  * Notes:
  *      calls a CRE if any of the above expectations is not met
  ************************/
@@ -183,7 +589,7 @@ void Bit2_map_col_major(Bit2_T B2,
                          void apply(int col, int row, Bit2_T B2, int 
                                val, void *cl), 
                          void *cl) {
-        assert(B2 != NULL);
+        assert_int_dims(B2);
         
         for (int col_idx = 0; col_idx < Bit2_width(B2); col_idx++) {
                 for (int row_idx = 0; row_idx < Bit2_height(B2); row_idx++) {
@@ -208,6 +614,7 @@ void Bit2_map_col_major(Bit2_T B2,
  *
  * Expects
  *      B2 is not NULL
+ *      the width and height each fit in an int
  * Notes:
  *      calls a CRE if any of the above expectations is not met
  ************************/
@@ -215,7 +622,7 @@ void Bit2_map_row_major(Bit2_T B2,
                          void apply(int col, int row, Bit2_T B2, int 
                                val, void *cl), 
                          void *cl) {
-        assert(B2 != NULL);
+        assert_int_dims(B2);
         for (int row_idx = 0; row_idx < Bit2_height(B2); row_idx++) {
                 for (int col_idx = 0; col_idx < Bit2_width(B2); col_idx++) {
                         apply(col_idx, row_idx, B2, Bit2_get(B2, col_idx, 
@@ -224,24 +631,1458 @@ void Bit2_map_row_major(Bit2_T B2,
         }   
 }
 
-/********** Bit2_free ********
+/********** Bit2_map_rows_span ********
  *
- * Frees the memory allocated by Bit2_new.
+ * Traverses the 2D bit vector one row at a time, top to bottom, calling the
+ * given apply function once per row with the packed words of that row.
  *
  * Parameters:
- *      Bit2_T *B2: a pointer to a pointer to a Bit2_T struct
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      apply: a function supplied by the client, called with the row index,
+ *      the words holding that row, and the number of bits in the row
+ *      void *cl: a void pointer to be determined by the client
  *
  * Return: Doesn't return anything.
  *
  * Expects
- *      B2 abnd &B2 and not NULL
+ *      B2 is not NULL
+ *      the width and height each fit in an int
  * Notes:
  *      calls a CRE if any of the above expectations is not met
- *      frees the internal Bit_T struct
+ *      the bit for column col is bit (col % 64) of words[col / 64]; the
+ *      client may modify the words, but must leave the bits past count zero
+ *      apply is not called for a Bit2 with a width of zero
+ *      for a view, each row is converted into a scratch row before apply is
+ *      called, and only the words apply changed are stored back, so that a
+ *      traversal that only reads never writes to the mapped file's pages
  ************************/
-void Bit2_free(Bit2_T *B2) {
-        assert(&B2 != NULL);
-        assert(B2 != NULL);
-        Bit_free(&(*B2)->B_internal);
-        free(*B2);
-}
\ No newline at end of file
+void Bit2_map_rows_span(Bit2_T B2, 
+                        void apply(int row, uint64_t *words, int count, 
+                                   void *cl), 
+                        void *cl) {
+        assert_int_dims(B2);
+        if (B2->width == 0) {
+                return;
+        }
+
+        if (B2->storage == STORAGE_VIEW) {
+                uint64_t *scratch = malloc(2 * B2->words_per_row * 
+                                           sizeof(uint64_t));
+                assert(scratch != NULL);
+                uint64_t *loaded = scratch + B2->words_per_row;
+                for (size_t row = 0; row < B2->height; row++) {
+                        for (size_t w = 0; w < B2->words_per_row; w++) {
+                                loaded[w] = view_load(B2, w, row);
+                                scratch[w] = loaded[w];
+                        }
+                        apply((int)row, scratch, (int)B2->width, cl);
+                        for (size_t w = 0; w < B2->words_per_row; w++) {
+                                if (scratch[w] != loaded[w]) {
+                                        view_store(B2, w, row, scratch[w]);
+                                }
+                        }
+                }
+                free(scratch);
+                return;
+        }
+
+        uint64_t *row_words = B2->words;
+        for (int row_idx = 0; row_idx < (int)B2->height; row_idx++) {
+                apply(row_idx, row_words, (int)B2->width, cl);
+                row_words += B2->words_per_row;
+        }
+}
+
+/********** Bit2_map_set_bits ********
+ *
+ * Traverses the 2D bit vector in row-major fashion, calling the given apply
+ * function only at the indices whose bit is 1.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *      it at each set bit
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      the width and height each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      whole words of zeros are skipped, and the set bits of a word are found
+ *      with count-trailing-zeros, so the cost grows with the number of set 
+ *      bits rather than with the area of the Bit2
+ *      apply may change any bit; each word is reread after every call, so a
+ *      bit cleared ahead of the traversal is not visited and a bit set ahead
+ *      of it is
+ ************************/
+void Bit2_map_set_bits(Bit2_T B2, 
+                       void apply(int col, int row, Bit2_T B2, void *cl), 
+                       void *cl) {
+        assert_int_dims(B2);
+
+        Bit2_Cursor cursor = Bit2_cursor(B2);
+        int col, row;
+        while (Bit2_cursor_next(&cursor, &col, &row)) {
+                apply(col, row, B2, cl);
+        }
+}
+
+/********** Bit2_map_border ********
+ *
+ * Calls the given apply function at each pixel on the edge of the 2D bit 
+ * vector: the top and bottom rows and the left and right columns.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *      it at each border pixel
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      the width and height each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      visits the top row left to right, then the bottom row left to right,
+ *      then the rest of the left column and the rest of the right column, 
+ *      top to bottom; each pixel is visited once, even when the Bit2 is only
+ *      one pixel wide or high
+ *      each bit is read just before apply is called on it, so apply may 
+ *      change bits that are yet to be visited
+ ************************/
+void Bit2_map_border(Bit2_T B2, 
+                     void apply(int col, int row, Bit2_T B2, int val, 
+                                void *cl), 
+                     void *cl) {
+        assert_int_dims(B2);
+        int width = (int)B2->width;
+        int height = (int)B2->height;
+        if (width == 0 || height == 0) {
+                return;
+        }
+
+        for (int col = 0; col < width; col++) {
+                apply(col, 0, B2, Bit2_get(B2, col, 0), cl);
+        }
+        if (height > 1) {
+                for (int col = 0; col < width; col++) {
+                        apply(col, height - 1, B2, 
+                              Bit2_get(B2, col, height - 1), cl);
+                }
+        }
+        for (int row = 1; row < height - 1; row++) {
+                apply(0, row, B2, Bit2_get(B2, 0, row), cl);
+        }
+        if (width > 1) {
+                for (int row = 1; row < height - 1; row++) {
+                        apply(width - 1, row, B2, 
+                              Bit2_get(B2, width - 1, row), cl);
+                }
+        }
+}
+
+/********** Bit2_flood_clear ********
+ *
+ * Clears every 1 bit that is 4-connected to the given pixel through 1 bits.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int col: the column of the pixel to start from
+ *      int row: the row of the pixel to start from
+ *
+ * Return: The number of bits cleared, which is 0 if the pixel is already 0.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      col and row are non-negative
+ *      col is less than the width and row is less than the height
+ *      the memory for the work stack can be allocated
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      a scanline fill: the run of 1s through a pixel is found and cleared 
+ *      a word at a time, and then one pixel of each run of 1s touching it in
+ *      the rows above and below is pushed, so the work stack grows with the
+ *      number of runs rather than the number of pixels
+ ************************/
+size_t Bit2_flood_clear(Bit2_T B2, int col, int row) {
+        assert(B2 != NULL);
+        assert(col >= 0 && (size_t)col < B2->width);
+        assert(row >= 0 && (size_t)row < B2->height);
+        if (Bit2_get(B2, col, row) == 0) {
+                return 0;
+        }
+
+        /* pixels to start runs from, each packed as (row << 32) | col */
+        size_t capacity = 64;
+        size_t count = 0;
+        uint64_t *stack = malloc(capacity * sizeof(uint64_t));
+        assert(stack != NULL);
+        stack[count++] = ((uint64_t)row << 32) | (uint32_t)col;
+
+        size_t cleared = 0;
+        while (count > 0) {
+                uint64_t pixel = stack[--count];
+                size_t y = pixel >> 32;
+                size_t x = pixel & 0xFFFFFFFF;
+                /* a run may be pushed from above and below; clear it once */
+                if (Bit2_get64(B2, x, y) == 0) {
+                        continue;
+                }
+
+                size_t first = run_start(B2, y, x);
+                size_t last = run_end(B2, y, x);
+                clear_run(B2, y, first, last);
+                cleared += last - first + 1;
+                if (y > 0) {
+                        push_runs(B2, y - 1, first, last, &stack, &count, 
+                                  &capacity);
+                }
+                if (y + 1 < B2->height) {
+                        push_runs(B2, y + 1, first, last, &stack, &count, 
+                                  &capacity);
+                }
+        }
+        free(stack);
+        return cleared;
+}
+
+/********** Bit2_spread ********
+ *
+ * Grows reach into every 1 bit of mask that is 4-connected, through 1 bits
+ * of mask, to a 1 bit of reach.
+ *
+ * Parameters:
+ *      Bit2_T reach: the seeds, which are replaced by everything they reach
+ *      Bit2_T mask: the bits that may be reached
+ *
+ * Return: The number of sweeps made over the grid.
+ *
+ * Expects
+ *      reach and mask are not NULL and have the same width and height, and 
+ *      are not the same Bit2
+ *      the memory for the bookkeeping (four words per row) can be allocated
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      bits of reach that are 0 in mask are cleared first
+ *      each sweep visits the rows in order, alternating between top to 
+ *      bottom and bottom to top: a row takes in the bits of the row before it
+ *      that are in its mask, and then spreads along its own runs of mask 
+ *      bits, in both directions, with shifts that double in length; the 
+ *      sweeps stop after the first one, past the first sweep, that changes
+ *      nothing
+ *      after the first sweep, a row only takes in the words of its neighbor
+ *      that changed since it last took bits from that neighbor, and only 
+ *      spreads as far as its own words keep changing, so a sweep costs time
+ *      in proportion to what changes rather than to the area; a region that
+ *      winds up and down many times (a spiral) still takes a sweep per turn
+ *      uses no stack; if either Bit2 is a view, the sweeps are made over 
+ *      copies in the usual layout
+ ************************/
+int Bit2_spread(Bit2_T reach, Bit2_T mask) {
+        assert_same_shape(reach, mask);
+        assert(reach != mask);
+        if (reach->storage == STORAGE_VIEW || mask->storage == STORAGE_VIEW) {
+                /* OR-ing a Bit2 with itself copies it */
+                Bit2_T reach_copy = Bit2_new64(reach->width, reach->height);
+                Bit2_T mask_copy = Bit2_new64(mask->width, mask->height);
+                Bit2_or(reach_copy, reach, reach);
+                Bit2_or(mask_copy, mask, mask);
+                int sweeps = Bit2_spread(reach_copy, mask_copy);
+                Bit2_or(reach, reach_copy, reach_copy);
+                Bit2_free(&reach_copy);
+                Bit2_free(&mask_copy);
+                return sweeps;
+        }
+
+        Bit2_and(reach, reach, mask);
+        size_t height = reach->height;
+        if (reach->width == 0 || height == 0) {
+                return 0;
+        }
+
+        /* for each row and each direction, the range of words that changed
+           since the next row in that direction last took bits from it; every
+           row starts out changed throughout */
+        size_t *pending = malloc(4 * height * sizeof(size_t));
+        assert(pending != NULL);
+        size_t *first[2] = { pending, pending + height };
+        size_t *last[2] = { pending + 2 * height, pending + 3 * height };
+        for (size_t row = 0; row < height; row++) {
+                first[0][row] = first[1][row] = 0;
+                last[0][row] = last[1][row] = reach->words_per_row - 1;
+        }
+
+        int sweeps = 0;
+        int changed;
+        do {
+                int dir = sweeps % 2;
+                changed = 0;
+                for (size_t i = 0; i < height; i++) {
+                        size_t row = (dir == 0) ? i : height - 1 - i;
+                        size_t from = (dir == 0) ? row - 1 : row + 1;
+                        size_t lo = 1;
+                        size_t hi = 0;
+                        if (from < height) {
+                                lo = first[dir][from];
+                                hi = last[dir][from];
+                                first[dir][from] = SIZE_MAX;
+                                last[dir][from] = 0;
+                        }
+                        if (sweeps > 0 && lo > hi) {
+                                continue;
+                        }
+
+                        size_t changed_lo, changed_hi;
+                        if (spread_row(reach, mask, row, from, lo, hi, 
+                                       sweeps == 0, &changed_lo, 
+                                       &changed_hi)) {
+                                changed = 1;
+                                for (int d = 0; d < 2; d++) {
+                                        if (changed_lo < first[d][row]) {
+                                                first[d][row] = changed_lo;
+                                        }
+                                        if (changed_hi > last[d][row]) {
+                                                last[d][row] = changed_hi;
+                                        }
+                                }
+                        }
+                }
+                sweeps++;
+                /* a sweep that changes nothing shows that no more bits can
+                   be reached in its direction; the sweep before it showed 
+                   the same for the other direction, unless there was none */
+        } while (changed || sweeps < 2);
+        free(pending);
+        return sweeps;
+}
+
+/********** Bit2_cursor ********
+ *
+ * Returns a cursor positioned before the first set bit of the Bit2_T, for 
+ * use with Bit2_cursor_next.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: A new cursor over B2.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      the width and height each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      the cursor holds no resources and needs no freeing
+ ************************/
+Bit2_Cursor Bit2_cursor(Bit2_T B2) {
+        assert_int_dims(B2);
+        Bit2_Cursor cursor = { B2, 0, 0 };
+        return cursor;
+}
+
+/********** Bit2_cursor_next ********
+ *
+ * Advances a cursor to the next set bit in row-major order.
+ *
+ * Parameters:
+ *      Bit2_Cursor *cursor: a pointer to a cursor made by Bit2_cursor
+ *      int *col: where to store the column of the set bit
+ *      int *row: where to store the row of the set bit
+ *
+ * Return: 1 if a set bit was found and stored in *col and *row, or 0 once 
+ *         every set bit has been visited.
+ *
+ * Expects
+ *      cursor, col, and row are not NULL
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      the words are read afresh on every call, so the client may change 
+ *      bits between calls, with the same effect as in Bit2_map_set_bits
+ ************************/
+int Bit2_cursor_next(Bit2_Cursor *cursor, int *col, int *row) {
+        assert(cursor != NULL && cursor->B2 != NULL);
+        assert(col != NULL && row != NULL);
+
+        Bit2_T B2 = cursor->B2;
+        size_t nwords = B2->words_per_row * B2->height;
+        size_t index = cursor->word;
+        if (index >= nwords) {
+                return 0;
+        }
+
+        /* drop the bits of the current word that were already visited */
+        uint64_t word = load_word(B2, index % B2->words_per_row, 
+                                  index / B2->words_per_row);
+        if (cursor->bit >= BITS_PER_WORD) {
+                word = 0;
+        } else {
+                word &= ~(uint64_t)0 << cursor->bit;
+        }
+        while (word == 0) {
+                index++;
+                if (index >= nwords) {
+                        cursor->word = nwords;
+                        cursor->bit = 0;
+                        return 0;
+                }
+                word = load_word(B2, index % B2->words_per_row, 
+                                 index / B2->words_per_row);
+        }
+
+        int bit = __builtin_ctzll(word);
+        *row = (int)(index / B2->words_per_row);
+        *col = (int)((index % B2->words_per_row) * BITS_PER_WORD) + bit;
+        cursor->word = index;
+        cursor->bit = bit + 1;
+        return 1;
+}
+
+/********** Bit2_and ********
+ *
+ * Sets each bit of dst to the AND of the corresponding bits of a and b.
+ *
+ * Parameters:
+ *      Bit2_T dst: a pointer to the Bit2_T struct to store the result in
+ *      Bit2_T a, Bit2_T b: pointers to the Bit2_T structs to combine
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst, a, and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      dst may be the same Bit2 as a or b
+ ************************/
+void Bit2_and(Bit2_T dst, Bit2_T a, Bit2_T b) {
+        assert_same_shape(dst, a);
+        assert_same_shape(dst, b);
+        combine_grids(dst, a, b, OP_AND);
+}
+
+/********** Bit2_or ********
+ *
+ * Sets each bit of dst to the OR of the corresponding bits of a and b.
+ *
+ * Parameters:
+ *      Bit2_T dst: a pointer to the Bit2_T struct to store the result in
+ *      Bit2_T a, Bit2_T b: pointers to the Bit2_T structs to combine
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst, a, and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      dst may be the same Bit2 as a or b
+ ************************/
+void Bit2_or(Bit2_T dst, Bit2_T a, Bit2_T b) {
+        assert_same_shape(dst, a);
+        assert_same_shape(dst, b);
+        combine_grids(dst, a, b, OP_OR);
+}
+
+/********** Bit2_xor ********
+ *
+ * Sets each bit of dst to the exclusive OR of the corresponding bits of a and
+ * b, so that dst marks the pixels where a and b differ.
+ *
+ * Parameters:
+ *      Bit2_T dst: a pointer to the Bit2_T struct to store the result in
+ *      Bit2_T a, Bit2_T b: pointers to the Bit2_T structs to combine
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst, a, and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      dst may be the same Bit2 as a or b
+ ************************/
+void Bit2_xor(Bit2_T dst, Bit2_T a, Bit2_T b) {
+        assert_same_shape(dst, a);
+        assert_same_shape(dst, b);
+        combine_grids(dst, a, b, OP_XOR);
+}
+
+/********** Bit2_andnot ********
+ *
+ * Sets each bit of dst to the corresponding bit of a AND NOT the 
+ * corresponding bit of b, which clears from a every pixel set in the mask b.
+ *
+ * Parameters:
+ *      Bit2_T dst: a pointer to the Bit2_T struct to store the result in
+ *      Bit2_T a: a pointer to the Bit2_T struct to mask
+ *      Bit2_T b: a pointer to the Bit2_T struct holding the mask
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst, a, and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      dst may be the same Bit2 as a or b
+ ************************/
+void Bit2_andnot(Bit2_T dst, Bit2_T a, Bit2_T b) {
+        assert_same_shape(dst, a);
+        assert_same_shape(dst, b);
+        combine_grids(dst, a, b, OP_ANDNOT);
+}
+
+/********** Bit2_not ********
+ *
+ * Sets each bit of dst to the inverse of the corresponding bit of src.
+ *
+ * Parameters:
+ *      Bit2_T dst: a pointer to the Bit2_T struct to store the result in
+ *      Bit2_T src: a pointer to the Bit2_T struct to invert
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst and src are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      dst may be the same Bit2 as src
+ *      the padding bits at the end of each row are cleared again afterwards
+ *      (a view never stores them)
+ ************************/
+void Bit2_not(Bit2_T dst, Bit2_T src) {
+        assert_same_shape(dst, src);
+        combine_grids(dst, src, src, OP_NOT);
+
+        size_t tail = dst->width % BITS_PER_WORD;
+        if (tail != 0 && dst->storage != STORAGE_VIEW) {
+                uint64_t mask = ((uint64_t)1 << tail) - 1;
+                uint64_t *last = dst->words + dst->words_per_row - 1;
+                for (size_t row = 0; row < dst->height; row++) {
+                        *last &= mask;
+                        last += dst->words_per_row;
+                }
+        }
+}
+
+/********** Bit2_popcount ********
+ *
+ * Counts the bits set in the whole Bit2_T.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: The number of bits that are 1.
+ *
+ * Expects
+ *      B2 is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+size_t Bit2_popcount(Bit2_T B2) {
+        assert(B2 != NULL);
+        if (B2->storage != STORAGE_VIEW) {
+                return count_words(B2->words, B2->words_per_row * B2->height);
+        }
+
+        uint64_t *scratch = malloc((B2->words_per_row + 1) * 
+                                   sizeof(uint64_t));
+        assert(scratch != NULL);
+        size_t count = 0;
+        for (size_t row = 0; row < B2->height; row++) {
+                count += count_words(row_words(B2, row, scratch), 
+                                     B2->words_per_row);
+        }
+        free(scratch);
+        return count;
+}
+
+/********** Bit2_popcount_row ********
+ *
+ * Counts the bits set in one row of the Bit2_T.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int row: the row to count
+ *
+ * Return: The number of bits in the row that are 1.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      row is non-negative and less than the height of the Bit2_T struct
+ *      the width fits in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ ************************/
+int Bit2_popcount_row(Bit2_T B2, int row) {
+        assert(B2 != NULL);
+        assert(row >= 0 && (size_t)row < B2->height);
+        assert(B2->width <= INT_MAX);
+        if (B2->storage != STORAGE_VIEW) {
+                return (int)count_words(B2->words + 
+                                        (size_t)row * B2->words_per_row,
+                                        B2->words_per_row);
+        }
+
+        int count = 0;
+        for (size_t w = 0; w < B2->words_per_row; w++) {
+                count += __builtin_popcountll(view_load(B2, w, row));
+        }
+        return count;
+}
+
+/********** Bit2_free ********
+ *
+ * Frees the memory allocated by Bit2_new.
+ *
+ * Parameters:
+ *      Bit2_T *B2: a pointer to a pointer to a Bit2_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B2 abnd &B2 and not NULL
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      frees the internal array of words, but not the buffer of a view
+ ************************/
+void Bit2_free(Bit2_T *B2) {
+        assert(&B2 != NULL);
+        assert(B2 != NULL);
+        if ((*B2)->storage == STORAGE_SNAPSHOT) {
+                Snapshot_unmap((*B2)->words, (*B2)->words_per_row * 
+                               (*B2)->height * sizeof(uint64_t));
+        } else if ((*B2)->storage == STORAGE_ARENA) {
+                return;
+        } else if ((*B2)->storage == STORAGE_HEAP) {
+                free((*B2)->words);
+        }
+        free(*B2);
+}
+
+/********** Bit2_save ********
+ *
+ * Writes the Bit2 to a snapshot file that Bit2_load and Bit2_load_mapped can
+ * reload without parsing.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      const char *path: name of the file to write
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B2 and path are not NULL
+ *      the file can be created and written
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      the snapshot records the width and height, followed by the words of 
+ *      each row as they are stored in memory
+ *      overwrites any existing file
+ *      a view is first copied into words of the usual layout
+ ************************/
+void Bit2_save(Bit2_T B2, const char *path) {
+        assert(B2 != NULL);
+        assert(path != NULL);
+
+        if (B2->storage == STORAGE_VIEW) {
+                /* row_words fills each row of the copy as its scratch */
+                Bit2_T copy = Bit2_new64(B2->width, B2->height);
+                for (size_t row = 0; row < B2->height; row++) {
+                        row_words(B2, row, copy->words + 
+                                  row * B2->words_per_row);
+                }
+                Bit2_save(copy, path);
+                Bit2_free(&copy);
+                return;
+        }
+
+        Snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.width = B2->width;
+        header.height = B2->height;
+        header.payload = B2->words_per_row * B2->height * sizeof(uint64_t);
+        Snapshot_save(path, header, B2->words);
+}
+
+/********** Bit2_load ********
+ *
+ * Reads a snapshot file written by Bit2_save into a new Bit2.
+ *
+ * Parameters:
+ *      const char *path: name of the snapshot file
+ *
+ * Return: A Bit2_T with the dimensions and bits recorded in the snapshot.
+ *
+ * Expects
+ *      the file is a valid Bit2 snapshot
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ *      the Bit2 is independent of the file once loaded
+ ************************/
+Bit2_T Bit2_load(const char *path) {
+        Snapshot_header header = Snapshot_read_header(path, SNAPSHOT_MAGIC);
+        Bit2_T B2 = Bit2_new64(header.width, header.height);
+        assert(header.payload == 
+               B2->words_per_row * B2->height * sizeof(uint64_t));
+        Snapshot_read_payload(path, B2->words, header.payload);
+        return B2;
+}
+
+/********** Bit2_load_mapped ********
+ *
+ * Maps the words stored in a snapshot file written by Bit2_save in place, so
+ * that loading costs only a header read.
+ *
+ * Parameters:
+ *      const char *path: name of the snapshot file
+ *      UArray2_filemode mode: UARRAY2_FILE_OPEN to write changes back to the
+ *      snapshot, or UARRAY2_FILE_PRIVATE for a copy-on-write view of it
+ *
+ * Return: A Bit2_T with the dimensions and bits recorded in the snapshot.
+ *
+ * Expects
+ *      the file is a valid Bit2 snapshot
+ *      mode is UARRAY2_FILE_OPEN or UARRAY2_FILE_PRIVATE
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ *      Bit2_free writes back a shared Bit2 and unmaps the file
+ ************************/
+Bit2_T Bit2_load_mapped(const char *path, UArray2_filemode mode) {
+        assert(mode == UARRAY2_FILE_OPEN || mode == UARRAY2_FILE_PRIVATE);
+        Snapshot_header header = Snapshot_read_header(path, SNAPSHOT_MAGIC);
+
+        Bit2_T B2 = malloc(sizeof(*B2));
+        assert(B2 != NULL);
+        size_t nwords = set_shape(B2, header.width, header.height);
+        assert(header.payload == mul_checked(nwords, sizeof(uint64_t)));
+        B2->words = Snapshot_map(path, header.payload, 
+                                 mode == UARRAY2_FILE_OPEN);
+        B2->storage = STORAGE_SNAPSHOT;
+        return B2;
+}
+
+/********** Bit2_is_snapshot ********
+ *
+ * Checks whether a file is a Bit2 snapshot.
+ *
+ * Parameters:
+ *      const char *path: name of the file to check
+ *
+ * Return: 1 if the file starts with the Bit2 snapshot magic, 0 otherwise
+ *         (including when the file cannot be opened).
+ *
+ * Expects
+ *      path is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+int Bit2_is_snapshot(const char *path) {
+        return Snapshot_probe(path, SNAPSHOT_MAGIC);
+}
+
+/********** mul_checked ********
+ *
+ * Multiplies two sizes, checking for overflow.
+ *
+ * Parameters:
+ *      size_t a, size_t b: the sizes to multiply
+ *
+ * Return: a * b
+ *
+ * Expects
+ *      a * b fits in a size_t
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+static size_t mul_checked(size_t a, size_t b) {
+        assert(b == 0 || a <= SIZE_MAX / b);
+        return a * b;
+}
+
+/********** assert_int_dims ********
+ *
+ * Checks that the Bit2 can be traversed with the int interface.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B2 is not NULL, and its width and height each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations is not met
+ ************************/
+static void assert_int_dims(Bit2_T B2) {
+        assert(B2 != NULL);
+        assert(B2->width <= INT_MAX);
+        assert(B2->height <= INT_MAX);
+}
+
+/********** set_shape ********
+ *
+ * Sets the width, height, and words per row of a Bit2_T, leaving its words
+ * and storage for the caller to fill in.
+ *
+ * Parameters:
+ *      Bit2_T B2: the struct to initialize
+ *      size_t width:  the width of the Bit2_T
+ *      size_t height: the height of the Bit2_T
+ *
+ * Return: the number of words needed to hold the bits
+ *
+ * Expects
+ *      the number of words does not overflow a size_t
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+static size_t set_shape(Bit2_T B2, size_t width, size_t height) {
+        B2->width = width;
+        B2->height = height;
+        B2->words_per_row = width / BITS_PER_WORD + 
+                            (width % BITS_PER_WORD != 0);
+        return mul_checked(B2->words_per_row, height);
+}
+
+/********** load_word ********
+ *
+ * Returns word word_col of a row, in the usual layout, whether or not the
+ * Bit2 is a view.
+ ************************/
+static uint64_t load_word(Bit2_T B2, size_t word_col, size_t row) {
+        if (B2->storage == STORAGE_VIEW) {
+                return view_load(B2, word_col, row);
+        }
+        return B2->words[row * B2->words_per_row + word_col];
+}
+
+/********** store_word ********
+ *
+ * Stores word word_col of a row, whose bits past the width must be zero
+ * unless the Bit2 is a view.
+ ************************/
+static void store_word(Bit2_T B2, size_t word_col, size_t row, 
+                       uint64_t word) {
+        if (B2->storage == STORAGE_VIEW) {
+                view_store(B2, word_col, row, word);
+        } else {
+                B2->words[row * B2->words_per_row + word_col] = word;
+        }
+}
+
+/********** view_load ********
+ *
+ * Assembles word word_col of a row of a view from the bytes of its buffer.
+ *
+ * Parameters:
+ *      Bit2_T B2: a view
+ *      size_t word_col: which word of the row, as for Bit2_get_word
+ *      size_t row: the row
+ *
+ * Return: The word, in the usual layout, with the bits past the width 
+ *         cleared.
+ *
+ * Notes:
+ *      byte i of the word's 8 bytes holds the bits for columns 
+ *      64 * word_col + 8 * i through 64 * word_col + 8 * i + 7; only the 
+ *      bytes that hold columns inside the width are read
+ ************************/
+static uint64_t view_load(Bit2_T B2, size_t word_col, size_t row) {
+        const unsigned char *p = B2->bytes + row * B2->row_stride + 
+                                 word_col * 8;
+        size_t row_bytes = B2->width / 8 + (B2->width % 8 != 0);
+        size_t n = row_bytes - word_col * 8;
+        uint64_t word = 0;
+        if (n >= 8) {
+                n = 8;
+        }
+        for (size_t i = 0; i < n; i++) {
+                word |= (uint64_t)p[i] << (8 * i);
+        }
+        if (B2->msb_first) {
+                word = reverse_byte_bits(word);
+        }
+
+        size_t tail = B2->width % BITS_PER_WORD;
+        if (tail != 0 && word_col == B2->words_per_row - 1) {
+                word &= ((uint64_t)1 << tail) - 1;
+        }
+        return word;
+}
+
+/********** view_store ********
+ *
+ * Scatters word word_col of a row of a view into the bytes of its buffer.
+ *
+ * Parameters:
+ *      Bit2_T B2: a view
+ *      size_t word_col: which word of the row, as for Bit2_put_word
+ *      size_t row: the row
+ *      uint64_t word: the word, in the usual layout
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      bits of word past the width are ignored; only the bytes that hold 
+ *      columns inside the width are written, and the padding bits of the 
+ *      last byte of the row keep their old values
+ ************************/
+static void view_store(Bit2_T B2, size_t word_col, size_t row, 
+                       uint64_t word) {
+        unsigned char *p = B2->bytes + row * B2->row_stride + word_col * 8;
+        size_t row_bytes = B2->width / 8 + (B2->width % 8 != 0);
+        size_t n = row_bytes - word_col * 8;
+        if (n >= 8) {
+                n = 8;
+        }
+        size_t word_tail = B2->width % BITS_PER_WORD;
+        if (word_tail != 0 && word_col == B2->words_per_row - 1) {
+                word &= ((uint64_t)1 << word_tail) - 1;
+        }
+        if (B2->msb_first) {
+                word = reverse_byte_bits(word);
+        }
+
+        /* the padding bits of the last byte of the row keep their values */
+        size_t tail = B2->width % 8;
+        if (tail != 0 && word_col * 8 + n == row_bytes) {
+                unsigned char keep = B2->msb_first ? 0xFF >> tail 
+                                                   : 0xFF << tail;
+                word |= (uint64_t)(p[n - 1] & keep) << (8 * (n - 1));
+        }
+        for (size_t i = 0; i < n; i++) {
+                p[i] = (unsigned char)(word >> (8 * i));
+        }
+}
+
+/********** run_start ********
+ *
+ * Returns the first column of the run of 1 bits in a row that ends at or 
+ * passes through col, whose bit must be 1.
+ ************************/
+static size_t run_start(Bit2_T B2, size_t row, size_t col) {
+        size_t w = col / BITS_PER_WORD;
+        int b = col % BITS_PER_WORD;
+        /* the 0 bits at or before col in word w */
+        uint64_t zeros = ~load_word(B2, w, row) & 
+                         (~(uint64_t)0 >> (BITS_PER_WORD - 1 - b));
+        while (zeros == 0) {
+                if (w == 0) {
+                        return 0;
+                }
+                w--;
+                zeros = ~load_word(B2, w, row);
+        }
+        return w * BITS_PER_WORD + (BITS_PER_WORD - __builtin_clzll(zeros));
+}
+
+/********** run_end ********
+ *
+ * Returns the last column of the run of 1 bits in a row that starts at or 
+ * passes through col, whose bit must be 1.
+ ************************/
+static size_t run_end(Bit2_T B2, size_t row, size_t col) {
+        size_t w = col / BITS_PER_WORD;
+        int b = col % BITS_PER_WORD;
+        /* the 0 bits at or after col in word w; the padding counts as 0 */
+        uint64_t zeros = ~load_word(B2, w, row) & (~(uint64_t)0 << b);
+        while (zeros == 0) {
+                w++;
+                if (w == B2->words_per_row) {
+                        return B2->width - 1;
+                }
+                zeros = ~load_word(B2, w, row);
+        }
+        return w * BITS_PER_WORD + __builtin_ctzll(zeros) - 1;
+}
+
+/********** next_set ********
+ *
+ * Returns the first column from col through last whose bit in a row is 1,
+ * or SIZE_MAX if there is none.
+ ************************/
+static size_t next_set(Bit2_T B2, size_t row, size_t col, size_t last) {
+        size_t w = col / BITS_PER_WORD;
+        size_t last_w = last / BITS_PER_WORD;
+        uint64_t ones = load_word(B2, w, row) & 
+                        (~(uint64_t)0 << (col % BITS_PER_WORD));
+        while (ones == 0) {
+                if (w == last_w) {
+                        return SIZE_MAX;
+                }
+                w++;
+                ones = load_word(B2, w, row);
+        }
+        size_t found = w * BITS_PER_WORD + __builtin_ctzll(ones);
+        return (found <= last) ? found : SIZE_MAX;
+}
+
+/********** clear_run ********
+ *
+ * Clears the bits of a row from column first through column last, a word 
+ * at a time.
+ ************************/
+static void clear_run(Bit2_T B2, size_t row, size_t first, size_t last) {
+        size_t first_w = first / BITS_PER_WORD;
+        size_t last_w = last / BITS_PER_WORD;
+        for (size_t w = first_w; w <= last_w; w++) {
+                uint64_t mask = ~(uint64_t)0;
+                if (w == first_w) {
+                        mask &= ~(uint64_t)0 << (first % BITS_PER_WORD);
+                }
+                if (w == last_w) {
+                        mask &= ~(uint64_t)0 >> 
+                                (BITS_PER_WORD - 1 - last % BITS_PER_WORD);
+                }
+                store_word(B2, w, row, load_word(B2, w, row) & ~mask);
+        }
+}
+
+/********** push_runs ********
+ *
+ * Pushes one pixel of each run of 1 bits in a row that overlaps columns 
+ * first through last onto the work stack of Bit2_flood_clear, doubling the
+ * stack when it is full.
+ ************************/
+static void push_runs(Bit2_T B2, size_t row, size_t first, size_t last, 
+                      uint64_t **stack, size_t *count, size_t *capacity) {
+        size_t col = next_set(B2, row, first, last);
+        while (col != SIZE_MAX) {
+                if (*count == *capacity) {
+                        *capacity *= 2;
+                        *stack = realloc(*stack, 
+                                         *capacity * sizeof(uint64_t));
+                        assert(*stack != NULL);
+                }
+                (*stack)[(*count)++] = ((uint64_t)row << 32) | col;
+
+                size_t end = run_end(B2, row, col);
+                if (end + 2 > last) {
+                        return;
+                }
+                col = next_set(B2, row, end + 2, last);
+        }
+}
+
+/********** spread_row ********
+ *
+ * Does the work of Bit2_spread for one row.
+ *
+ * Parameters:
+ *      Bit2_T reach, Bit2_T mask: as for Bit2_spread, neither a view
+ *      size_t row: the row to grow
+ *      size_t from: the neighboring row to take bits from, or a row past the
+ *      edge (SIZE_MAX or the height) for none
+ *      size_t lo, size_t hi: the words of the neighboring row to take
+ *      int whole: 1 to spread from every bit of the row, as the first sweep
+ *      must; 0 to spread only from what changes, since the row was already
+ *      spread along its runs
+ *      size_t *changed_lo, size_t *changed_hi: where to store the range of
+ *      words of the row that changed
+ *
+ * Return: 1 if the row of reach changed, 0 otherwise.
+ ************************/
+static int spread_row(Bit2_T reach, Bit2_T mask, size_t row, size_t from, 
+                      size_t lo, size_t hi, int whole, size_t *changed_lo, 
+                      size_t *changed_hi) {
+        size_t wpr = reach->words_per_row;
+        uint64_t *x = reach->words + row * wpr;
+        const uint64_t *m = mask->words + row * wpr;
+        size_t clo = SIZE_MAX;
+        size_t chi = 0;
+
+        /* take in the neighboring row: find the first and last words that
+           gain bits, then OR in the words between them, a loop that 
+           vectorizes */
+        if (from < reach->height && lo <= hi) {
+                const uint64_t *near = reach->words + from * wpr;
+                size_t w = lo;
+                while (w <= hi && (near[w] & m[w] & ~x[w]) == 0) {
+                        w++;
+                }
+                if (w <= hi) {
+                        clo = w;
+                        chi = hi;
+                        while ((near[chi] & m[chi] & ~x[chi]) == 0) {
+                                chi--;
+                        }
+                        for (w = clo; w <= chi; w++) {
+                                x[w] |= near[w] & m[w];
+                        }
+                }
+        }
+        if (whole) {
+                clo = 0;
+                chi = wpr - 1;
+        } else if (clo > chi) {
+                return 0;
+        }
+
+        /* spread up the runs from the changed words, carrying across words,
+           until a word past them stays the same */
+        size_t start = clo;
+        size_t end = chi;
+        uint64_t carry = 0;
+        for (size_t w = start; w < wpr; w++) {
+                uint64_t grown = fill_up(x[w] | (carry & m[w]), m[w]);
+                if (grown != x[w]) {
+                        x[w] = grown;
+                        chi = (w > chi) ? w : chi;
+                } else if (w > end) {
+                        break;
+                }
+                carry = grown >> (BITS_PER_WORD - 1);
+        }
+
+        /* and then down them */
+        start = chi;
+        end = clo;
+        carry = 0;
+        for (size_t w = start + 1; w-- > 0; ) {
+                uint64_t grown = fill_down(x[w] | ((carry << 63) & m[w]), 
+                                           m[w]);
+                if (grown != x[w]) {
+                        x[w] = grown;
+                        clo = (w < clo) ? w : clo;
+                } else if (w < end) {
+                        break;
+                }
+                carry = grown & 1;
+        }
+
+        *changed_lo = clo;
+        *changed_hi = chi;
+        return 1;
+}
+
+/********** fill_up ********
+ *
+ * Spreads the 1 bits of x toward the high end of the word through the runs
+ * of 1 bits of m that hold them; x must be within m.
+ ************************/
+static uint64_t fill_up(uint64_t x, uint64_t m) {
+        x |= m & (x << 1);
+        m &= m << 1;
+        x |= m & (x << 2);
+        m &= m << 2;
+        x |= m & (x << 4);
+        m &= m << 4;
+        x |= m & (x << 8);
+        m &= m << 8;
+        x |= m & (x << 16);
+        m &= m << 16;
+        x |= m & (x << 32);
+        return x;
+}
+
+/********** fill_down ********
+ *
+ * Spreads the 1 bits of x toward the low end of the word through the runs
+ * of 1 bits of m that hold them; x must be within m.
+ ************************/
+static uint64_t fill_down(uint64_t x, uint64_t m) {
+        x |= m & (x >> 1);
+        m &= m >> 1;
+        x |= m & (x >> 2);
+        m &= m >> 2;
+        x |= m & (x >> 4);
+        m &= m >> 4;
+        x |= m & (x >> 8);
+        m &= m >> 8;
+        x |= m & (x >> 16);
+        m &= m >> 16;
+        x |= m & (x >> 32);
+        return x;
+}
+
+/********** reverse_byte_bits ********
+ *
+ * Reverses the order of the bits within each byte of a word, converting 
+ * between MSB-first and LSB-first bytes.
+ ************************/
+static uint64_t reverse_byte_bits(uint64_t word) {
+        word = ((word >> 1) & 0x5555555555555555u) | 
+               ((word & 0x5555555555555555u) << 1);
+        word = ((word >> 2) & 0x3333333333333333u) | 
+               ((word & 0x3333333333333333u) << 2);
+        word = ((word >> 4) & 0x0F0F0F0F0F0F0F0Fu) | 
+               ((word & 0x0F0F0F0F0F0F0F0Fu) << 4);
+        return word;
+}
+
+/********** row_words ********
+ *
+ * Returns the words of a row in the usual layout: the row itself, or, for a
+ * view, a copy of it made in scratch.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      size_t row: the row
+ *      uint64_t *scratch: room for words_per_row words
+ *
+ * Return: A pointer to the words of the row.
+ ************************/
+static const uint64_t *row_words(Bit2_T B2, size_t row, uint64_t *scratch) {
+        if (B2->storage != STORAGE_VIEW) {
+                return B2->words + row * B2->words_per_row;
+        }
+        for (size_t w = 0; w < B2->words_per_row; w++) {
+                scratch[w] = view_load(B2, w, row);
+        }
+        return scratch;
+}
+
+/********** assert_same_shape ********
+ *
+ * Checks that two Bit2s can be combined by the bulk operations.
+ *
+ * Parameters:
+ *      Bit2_T a, Bit2_T b: pointers to Bit2_T structs
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      a and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+static void assert_same_shape(Bit2_T a, Bit2_T b) {
+        assert(a != NULL && b != NULL);
+        assert(a->width == b->width);
+        assert(a->height == b->height);
+}
+
+/********** combine_grids ********
+ *
+ * Applies a bulk operation to whole grids of the same shape.
+ *
+ * Parameters:
+ *      Bit2_T dst: where to store the results
+ *      Bit2_T a, Bit2_T b: the operands (b is ignored by OP_NOT)
+ *      bulk_op op: the operation
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      the words of grids that are not views are combined as one flat array;
+ *      if any grid is a view, the grids are combined a row at a time, with 
+ *      each row of a view converted into a scratch row
+ ************************/
+static void combine_grids(Bit2_T dst, Bit2_T a, Bit2_T b, bulk_op op) {
+        size_t wpr = dst->words_per_row;
+        if (dst->storage != STORAGE_VIEW && a->storage != STORAGE_VIEW &&
+            b->storage != STORAGE_VIEW) {
+                combine_words(dst->words, a->words, b->words, 
+                              wpr * dst->height, op);
+                return;
+        }
+
+        uint64_t *scratch = malloc((3 * wpr + 1) * sizeof(uint64_t));
+        assert(scratch != NULL);
+        for (size_t row = 0; row < dst->height; row++) {
+                const uint64_t *ra = row_words(a, row, scratch);
+                const uint64_t *rb = row_words(b, row, scratch + wpr);
+                uint64_t *out = (dst->storage == STORAGE_VIEW) 
+                                ? scratch + 2 * wpr 
+                                : dst->words + row * wpr;
+                combine_words(out, ra, rb, wpr, op);
+                if (dst->storage == STORAGE_VIEW) {
+                        for (size_t w = 0; w < wpr; w++) {
+                                view_store(dst, w, row, out[w]);
+                        }
+                }
+        }
+        free(scratch);
+}
+
+/********** combine_words ********
+ *
+ * Applies a bulk operation to n words, choosing the fastest kernel the
+ * processor supports.
+ *
+ * Parameters:
+ *      uint64_t *dst: where to store the results
+ *      const uint64_t *a, const uint64_t *b: the operands (b is ignored by
+ *      OP_NOT)
+ *      size_t n: the number of words
+ *      bulk_op op: the operation
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      dst, a, and b each hold n words; dst may be a or b
+ ************************/
+static void combine_words(uint64_t *dst, const uint64_t *a, 
+                          const uint64_t *b, size_t n, bulk_op op) {
+#if defined(BIT2_X86)
+        if (__builtin_cpu_supports("avx2")) {
+                combine_avx2(dst, a, b, n, op);
+                return;
+        }
+#endif
+        combine_scalar(dst, a, b, n, op);
+}
+
+/********** combine_scalar ********
+ *
+ * Applies a bulk operation to n words, two at a time with SSE2 where the 
+ * compiler targets it and one at a time otherwise.
+ *
+ * Parameters and expectations are as for combine_words.
+ ************************/
+static void combine_scalar(uint64_t *dst, const uint64_t *a, 
+                           const uint64_t *b, size_t n, bulk_op op) {
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128i ones = _mm_set1_epi32(-1);
+        for (; i + 2 <= n; i += 2) {
+                __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+                __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+                __m128i r;
+                switch (op) {
+                case OP_AND:    r = _mm_and_si128(x, y);        break;
+                case OP_OR:     r = _mm_or_si128(x, y);         break;
+                case OP_XOR:    r = _mm_xor_si128(x, y);        break;
+                case OP_ANDNOT: r = _mm_andnot_si128(y, x);     break;
+                default:        r = _mm_xor_si128(x, ones);     break;
+                }
+                _mm_storeu_si128((__m128i *)(dst + i), r);
+        }
+#endif
+        for (; i < n; i++) {
+                switch (op) {
+                case OP_AND:    dst[i] = a[i] & b[i];   break;
+                case OP_OR:     dst[i] = a[i] | b[i];   break;
+                case OP_XOR:    dst[i] = a[i] ^ b[i];   break;
+                case OP_ANDNOT: dst[i] = a[i] & ~b[i];  break;
+                default:        dst[i] = ~a[i];         break;
+                }
+        }
+}
+
+/********** count_words ********
+ *
+ * Counts the bits set in n words, choosing the fastest kernel the processor
+ * supports.
+ *
+ * Parameters:
+ *      const uint64_t *words: the words to count
+ *      size_t n: the number of words
+ *
+ * Return: The number of bits that are 1.
+ ************************/
+static size_t count_words(const uint64_t *words, size_t n) {
+#if defined(BIT2_X86)
+        if (__builtin_cpu_supports("avx2")) {
+                return count_avx2(words, n);
+        }
+        if (__builtin_cpu_supports("popcnt")) {
+                return count_popcnt(words, n);
+        }
+#endif
+        return count_scalar(words, n);
+}
+
+/********** count_scalar ********
+ *
+ * Counts the bits set in n words, one word at a time.
+ *
+ * Parameters and return are as for count_words.
+ ************************/
+static size_t count_scalar(const uint64_t *words, size_t n) {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+                count += __builtin_popcountll(words[i]);
+        }
+        return count;
+}
+
+#if defined(BIT2_X86)
+/********** combine_avx2 ********
+ *
+ * Applies a bulk operation to n words, four at a time with AVX2.
+ *
+ * Parameters and expectations are as for combine_words.
+ *
+ * Notes:
+ *      only called when the processor supports AVX2
+ ************************/
+__attribute__((target("avx2")))
+static void combine_avx2(uint64_t *dst, const uint64_t *a, 
+                         const uint64_t *b, size_t n, bulk_op op) {
+        size_t i = 0;
+        __m256i ones = _mm256_set1_epi32(-1);
+        for (; i + 4 <= n; i += 4) {
+                __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+                __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+                __m256i r;
+                switch (op) {
+                case OP_AND:    r = _mm256_and_si256(x, y);     break;
+                case OP_OR:     r = _mm256_or_si256(x, y);      break;
+                case OP_XOR:    r = _mm256_xor_si256(x, y);     break;
+                case OP_ANDNOT: r = _mm256_andnot_si256(y, x);  break;
+                default:        r = _mm256_xor_si256(x, ones);  break;
+                }
+                _mm256_storeu_si256((__m256i *)(dst + i), r);
+        }
+        combine_scalar(dst + i, a + i, b + i, n - i, op);
+}
+
+/********** count_avx2 ********
+ *
+ * Counts the bits set in n words, four at a time with AVX2. Each byte is 
+ * split into two nibbles, the count of each nibble is looked up in a 
+ * 16-entry table with a byte shuffle, and the byte counts are summed into
+ * 64-bit lanes.
+ *
+ * Parameters and return are as for count_words.
+ *
+ * Notes:
+ *      only called when the processor supports AVX2
+ ************************/
+__attribute__((target("avx2")))
+static size_t count_avx2(const uint64_t *words, size_t n) {
+        const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 
+                                               1, 2, 2, 3, 2, 3, 3, 4,
+                                               0, 1, 1, 2, 1, 2, 2, 3, 
+                                               1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+                __m256i v = _mm256_loadu_si256((const __m256i *)(words + i));
+                __m256i lo = _mm256_and_si256(v, nibble);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), 
+                                              nibble);
+                __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                                                _mm256_shuffle_epi8(table, hi));
+                total = _mm256_add_epi64(total, 
+                                         _mm256_sad_epu8(bytes, 
+                                                 _mm256_setzero_si256()));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, total);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + 
+               count_popcnt(words + i, n - i);
+}
+
+/********** count_popcnt ********
+ *
+ * Counts the bits set in n words with the POPCNT instruction.
+ *
+ * Parameters and return are as for count_words.
+ *
+ * Notes:
+ *      only called when the processor supports POPCNT
+ ************************/
+__attribute__((target("popcnt")))
+static size_t count_popcnt(const uint64_t *words, size_t n) {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++) {
+                count += __builtin_popcountll(words[i]);
+        }
+        return count;
+}
+#endif
\ No newline at end of file
@@ -14,17 +14,106 @@
  *     associated with the Bit2. In this file, we typedef a Bit2_T to be a 
  *     pointer to a Bit2_T struct, as defined in the implementation. 
  *
+ *     Each row of a Bit2 starts on a fresh 64-bit word and takes 
+ *     Bit2_words_per_row words: the bit for column col is bit (col % 64) of 
+ *     word (col / 64), and any bits past the width in the last word are zero.
+ *     Bit2_get_word and Bit2_put_word read and write one such word, 64 
+ *     pixels at a time, and Bit2_map_rows_span hands the client the words of
+ *     one whole row at a time.
+ *
+ *     Bit2_new64, Bit2_width64, Bit2_height64, Bit2_get64, and Bit2_put64 take
+ *     and return size_t, for images with more pixels than fit in an int. The
+ *     int interface still works on such images as long as the width and 
+ *     height each fit in an int.
+ *
+ *     Bit2_save writes a Bit2 to a snapshot (see snapshot.h) holding its 
+ *     words exactly as they sit in memory. Bit2_load reads one back, and 
+ *     Bit2_load_mapped maps the words in place so that reloading costs a
+ *     header read, taking the same UArray2_filemode as UArray2_load_mapped.
+ *
+ *     Bit2_map_set_bits visits only the bits that are 1, in row-major order,
+ *     skipping zero words whole, so its cost follows the number of black 
+ *     pixels rather than the size of the image. A Bit2_Cursor does the same
+ *     traversal one bit per call to Bit2_cursor_next, for clients that want
+ *     to drive the loop themselves:
+ *
+ *             Bit2_Cursor cursor = Bit2_cursor(B2);
+ *             int col, row;
+ *             while (Bit2_cursor_next(&cursor, &col, &row)) { ... }
+ *
+ *     Bit2_map_border visits just the pixels on the edge of the image, each
+ *     once, so that work which can only start at the border costs time in 
+ *     proportion to the perimeter rather than the area.
+ *
+ *     Bit2_flood_clear clears the 4-connected region of 1 bits around a 
+ *     pixel. It works a span at a time rather than a pixel at a time: each
+ *     horizontal run of 1s is found and cleared with word operations, and 
+ *     only one pixel per run is kept on its work stack.
+ *
+ *     Bit2_spread does the same job for many seeds at once without any stack:
+ *     it grows a grid of seeds into every 1 bit of a mask connected to them,
+ *     with whole-word shifts, ANDs, and ORs in raster sweeps that alternate 
+ *     between top-down and bottom-up until nothing changes.
+ *
+ *     Bit2_and, Bit2_or, Bit2_xor, Bit2_andnot, and Bit2_not combine whole 
+ *     grids of the same shape into a destination grid (which may be one of 
+ *     the operands), and Bit2_popcount and Bit2_popcount_row count set bits.
+ *     They work on whole words with SIMD where available, so comparing or 
+ *     masking a scan against a template needs no per-pixel loop.
+ *
+ *     Bit2_new_in allocates a Bit2, handle and words alike, from a 
+ *     UArray2_Arena (see arena2.h); UArray2_Arena_reset releases it along 
+ *     with everything else in the arena.
+ *
+ *     Bit2_wrap_buffer makes a Bit2 that is a view of bits the client already
+ *     has in memory, such as the payload of a raw (P4) pbm file mapped with
+ *     mmap, where each row starts on a fresh byte and the first pixel is the
+ *     high bit of its byte. Nothing is copied, so wrapping costs the same
+ *     for any size of image, and puts change the client's bytes. Every other
+ *     Bit2 function works on a view; words passed to and from the client 
+ *     are in the usual layout, and are converted a word at a time.
+ *
  ******************************************************************************/
 #ifndef BIT2_INCLUDED
 #define BIT2_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
+#include "arena2.h"
+#include "snapshot.h"
+
 typedef struct Bit2_T *Bit2_T; 
 
+/* position of a traversal of the set bits of a Bit2; see Bit2_cursor */
+typedef struct Bit2_Cursor {
+        Bit2_T B2;
+        size_t word;    /* index of the word holding the last bit visited */
+        int bit;        /* position in that word of the next bit to check */
+} Bit2_Cursor;
+
+/* order of the pixels within each byte of a buffer wrapped by a Bit2 */
+typedef enum {
+        BIT2_LSB_FIRST,         /* the first pixel is bit 0 of its byte */
+        BIT2_MSB_FIRST          /* the first pixel is bit 7, as in a P4 pbm */
+} Bit2_bit_order;
+
 Bit2_T Bit2_new(int width, int height);
 extern int Bit2_width(Bit2_T B2);
 extern int Bit2_height(Bit2_T B2);
 extern int Bit2_get(Bit2_T B2, int col, int row);
 extern int Bit2_put(Bit2_T B2, int col, int row, int bit);
+Bit2_T Bit2_new64(size_t width, size_t height);
+Bit2_T Bit2_new_in(UArray2_Arena_T arena, int width, int height);
+Bit2_T Bit2_wrap_buffer(void *bytes, int width, int height, 
+                        size_t row_stride, Bit2_bit_order order);
+extern size_t Bit2_width64(Bit2_T B2);
+extern size_t Bit2_height64(Bit2_T B2);
+extern int Bit2_get64(Bit2_T B2, size_t col, size_t row);
+extern int Bit2_put64(Bit2_T B2, size_t col, size_t row, int bit);
+extern int Bit2_words_per_row(Bit2_T B2);
+extern uint64_t Bit2_get_word(Bit2_T B2, int word_col, int row);
+extern uint64_t Bit2_put_word(Bit2_T B2, int word_col, int row, 
+                              uint64_t word);
 extern void Bit2_map_col_major(Bit2_T B2, 
                                void apply(int col, int row, Bit2_T B2, int val,
                                           void *cl), 
@@ -33,6 +122,33 @@ extern void Bit2_map_row_major(Bit2_T B2,
                                void apply(int col, int row, Bit2_T B2, int val,
                                           void *cl), 
                                void *cl);
+extern void Bit2_map_rows_span(Bit2_T B2, 
+                               void apply(int row, uint64_t *words, int count,
+                                          void *cl), 
+                               void *cl);
+extern void Bit2_map_set_bits(Bit2_T B2, 
+                              void apply(int col, int row, Bit2_T B2, 
+                                         void *cl), 
+                              void *cl);
+extern void Bit2_map_border(Bit2_T B2, 
+                            void apply(int col, int row, Bit2_T B2, int val,
+                                       void *cl), 
+                            void *cl);
+extern size_t Bit2_flood_clear(Bit2_T B2, int col, int row);
+extern int Bit2_spread(Bit2_T reach, Bit2_T mask);
+extern Bit2_Cursor Bit2_cursor(Bit2_T B2);
+extern int Bit2_cursor_next(Bit2_Cursor *cursor, int *col, int *row);
+extern void Bit2_and(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2_or(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2_xor(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2_andnot(Bit2_T dst, Bit2_T a, Bit2_T b);
+extern void Bit2_not(Bit2_T dst, Bit2_T src);
+extern size_t Bit2_popcount(Bit2_T B2);
+extern int Bit2_popcount_row(Bit2_T B2, int row);
 extern void Bit2_free(Bit2_T *B2);
+extern void Bit2_save(Bit2_T B2, const char *path);
+Bit2_T Bit2_load(const char *path);
+Bit2_T Bit2_load_mapped(const char *path, UArray2_filemode mode);
+extern int Bit2_is_snapshot(const char *path);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,617 @@
+/*******************************************************************************
+ *
+ *                     bit2rle.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of the Bit2RLE data structure.
+ *     Each row keeps a growable array of runs of 1 bits, stored as pairs of
+ *     ints: the first column of the run and the column just past its end.
+ *     The runs of a row are sorted, never overlap, and never touch (two runs
+ *     that would touch are merged into one), so every row has exactly one
+ *     representation. A row with no ink has no array at all.
+ *
+ ******************************************************************************/
+#include "bit2rle.h"
+#include "except.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define BITS_PER_WORD 64
+
+struct row_runs {
+        int count;              /* number of runs in the row */
+        int capacity;           /* number of runs the array has room for */
+        int *runs;              /* start, end pairs, end exclusive */
+};
+
+struct Bit2RLE_T {
+        int width;
+        int height;
+        struct row_runs *rows;
+};
+
+static int upper_bound(struct row_runs *r, int col);
+static void insert_run(struct row_runs *r, int pos, int start, int end);
+static void remove_run(struct row_runs *r, int pos);
+static void add_row_runs(int row, uint64_t *words, int count, void *cl);
+static void set_range(Bit2_T B2, int row, int start, int end);
+
+/********** Bit2RLE_new ********
+ *
+ * Allocates, initializes, and returns a new Bit2RLE_T.
+ *
+ * Parameters:
+ *      int width:  an integer for the width of the Bit2RLE_T
+ *      int height: an integer for the height of the Bit2RLE_T
+ *
+ * Return: Returns the newly created Bit2RLE_T struct.
+ *
+ * Expects
+ *      width and height are non-negative
+ *      the memory can be allocated
+ * Notes:
+ *      will call a CRE if the above expectations are not met
+ *      the memory associated with B is freed using Bit2RLE_free
+ *      every bit starts out as 0, which costs no memory beyond one empty
+ *      entry per row
+ ************************/
+Bit2RLE_T Bit2RLE_new(int width, int height) {
+        assert(width >= 0);
+        assert(height >= 0);
+
+        Bit2RLE_T B = malloc(sizeof(*B));
+        assert(B != NULL);
+        B->width = width;
+        B->height = height;
+        /* one spare row so that an empty Bit2RLE still gets an allocation */
+        B->rows = calloc((size_t)height + 1, sizeof(struct row_runs));
+        assert(B->rows != NULL);
+        return B;
+}
+
+/********** Bit2RLE_width ********
+ *
+ * Returns the width of the Bit2RLE_T struct.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *
+ * Return: Returns the width of the Bit2RLE_T struct.
+ *
+ * Expects
+ *      B to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+int Bit2RLE_width(Bit2RLE_T B) {
+        assert(B != NULL);
+        return B->width;
+}
+
+/********** Bit2RLE_height ********
+ *
+ * Returns the height of the Bit2RLE_T struct.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *
+ * Return: Returns the height of the Bit2RLE_T struct.
+ *
+ * Expects
+ *      B to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+int Bit2RLE_height(Bit2RLE_T B) {
+        assert(B != NULL);
+        return B->height;
+}
+
+/********** Bit2RLE_get ********
+ *
+ * Returns the value of the bit at the given index.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      int col: the column of the index of the bit
+ *      int row: the row of the index of the bit
+ *
+ * Return: The value of the bit at the given index.
+ *
+ * Expects
+ *      B is not NULL
+ *      col and row are non-negative
+ *      col is less than the width and row is less than the height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      binary searches the runs of the row, so it takes time logarithmic in
+ *      the number of runs in the row
+ ************************/
+int Bit2RLE_get(Bit2RLE_T B, int col, int row) {
+        assert(B != NULL);
+        assert(col >= 0 && col < B->width);
+        assert(row >= 0 && row < B->height);
+
+        struct row_runs *r = &B->rows[row];
+        int i = upper_bound(r, col);
+        return i > 0 && r->runs[2 * (i - 1) + 1] > col;
+}
+
+/********** Bit2RLE_put ********
+ *
+ * Inserts the given value at the index and returns the previous value.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      int col: the column of the index of the bit
+ *      int row: the row of the index of the bit
+ *      int bit: the value that is to be inserted
+ *
+ * Return: The value of the previous bit at the given index.
+ *
+ * Expects
+ *      B is not NULL
+ *      col and row are non-negative
+ *      col is less than the width and row is less than the height
+ *      the bit value to be inserted is either 0 or 1
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      setting a bit next to a run grows the run, and may merge it with the
+ *      next one; clearing a bit inside a run may split it in two
+ ************************/
+int Bit2RLE_put(Bit2RLE_T B, int col, int row, int bit) {
+        assert(B != NULL);
+        assert(col >= 0 && col < B->width);
+        assert(row >= 0 && row < B->height);
+        assert(bit == 1 || bit == 0);
+
+        struct row_runs *r = &B->rows[row];
+        int i = upper_bound(r, col);
+        int *prev = (i > 0) ? &r->runs[2 * (i - 1)] : NULL;
+        int *next = (i < r->count) ? &r->runs[2 * i] : NULL;
+        int was = prev != NULL && prev[1] > col;
+        if (was == bit) {
+                return was;
+        }
+
+        if (bit == 1) {
+                if (prev != NULL && prev[1] == col) {
+                        prev[1]++;
+                        if (next != NULL && next[0] == col + 1) {
+                                prev[1] = next[1];
+                                remove_run(r, i);
+                        }
+                } else if (next != NULL && next[0] == col + 1) {
+                        next[0]--;
+                } else {
+                        insert_run(r, i, col, col + 1);
+                }
+        } else {
+                int start = prev[0];
+                int end = prev[1];
+                if (start == col && end == col + 1) {
+                        remove_run(r, i - 1);
+                } else if (start == col) {
+                        prev[0]++;
+                } else if (end == col + 1) {
+                        prev[1]--;
+                } else {
+                        prev[1] = col;
+                        insert_run(r, i, col + 1, end);
+                }
+        }
+        return was;
+}
+
+/********** Bit2RLE_map_col_major ********
+ *
+ * Traverses the Bit2RLE in column-major fashion, calling the given apply
+ * function at each index.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *      it at each index
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B is not NULL
+ *      apply does not change the Bit2RLE
+ * Notes:
+ *      calls a CRE if the first expectation is not met
+ *      keeps one position per row, so that each run is found once rather
+ *      than searched for at every index
+ ************************/
+void Bit2RLE_map_col_major(Bit2RLE_T B,
+                           void apply(int col, int row, Bit2RLE_T B,
+                                      int val, void *cl),
+                           void *cl) {
+        assert(B != NULL);
+
+        int *next_run = calloc((size_t)B->height + 1, sizeof(int));
+        assert(next_run != NULL);
+        for (int col_idx = 0; col_idx < B->width; col_idx++) {
+                for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                        struct row_runs *r = &B->rows[row_idx];
+                        int k = next_run[row_idx];
+                        while (k < r->count && r->runs[2 * k + 1] <= col_idx) {
+                                k++;
+                        }
+                        next_run[row_idx] = k;
+                        int val = k < r->count && r->runs[2 * k] <= col_idx;
+                        apply(col_idx, row_idx, B, val, cl);
+                }
+        }
+        free(next_run);
+}
+
+/********** Bit2RLE_map_row_major ********
+ *
+ * Traverses the Bit2RLE in row-major fashion, calling the given apply
+ * function at each index.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *      it at each index
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B is not NULL
+ *      apply does not change the Bit2RLE
+ * Notes:
+ *      calls a CRE if the first expectation is not met
+ ************************/
+void Bit2RLE_map_row_major(Bit2RLE_T B,
+                           void apply(int col, int row, Bit2RLE_T B,
+                                      int val, void *cl),
+                           void *cl) {
+        assert(B != NULL);
+        for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                struct row_runs *r = &B->rows[row_idx];
+                int k = 0;
+                for (int col_idx = 0; col_idx < B->width; col_idx++) {
+                        while (k < r->count && r->runs[2 * k + 1] <= col_idx) {
+                                k++;
+                        }
+                        int val = k < r->count && r->runs[2 * k] <= col_idx;
+                        apply(col_idx, row_idx, B, val, cl);
+                }
+        }
+}
+
+/********** Bit2RLE_map_runs ********
+ *
+ * Traverses the runs of 1 bits, top to bottom and left to right, calling the
+ * given apply function once per run.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      apply: a function supplied by the client, called with the row of the
+ *      run, its first column, and its length
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B is not NULL
+ *      apply does not change the Bit2RLE
+ * Notes:
+ *      calls a CRE if the first expectation is not met
+ *      the cost grows with the number of runs, not the area of the Bit2RLE
+ ************************/
+void Bit2RLE_map_runs(Bit2RLE_T B,
+                      void apply(int row, int start, int length, void *cl),
+                      void *cl) {
+        assert(B != NULL);
+        for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                struct row_runs *r = &B->rows[row_idx];
+                for (int k = 0; k < r->count; k++) {
+                        int start = r->runs[2 * k];
+                        apply(row_idx, start, r->runs[2 * k + 1] - start, cl);
+                }
+        }
+}
+
+/********** Bit2RLE_row_runs ********
+ *
+ * Returns the number of runs of 1 bits in a row.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *      int row: the row
+ *
+ * Return: The number of runs in the row.
+ *
+ * Expects
+ *      B is not NULL
+ *      row is non-negative and less than the height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ ************************/
+int Bit2RLE_row_runs(Bit2RLE_T B, int row) {
+        assert(B != NULL);
+        assert(row >= 0 && row < B->height);
+        return B->rows[row].count;
+}
+
+/********** Bit2RLE_from_bit2 ********
+ *
+ * Creates a Bit2RLE holding the same bits as a dense Bit2.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: A new Bit2RLE_T, to be freed with Bit2RLE_free.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      the width and height of B2 each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      finds the runs a word at a time with count-trailing-zeros, so the cost
+ *      grows with the number of words and runs rather than pixels
+ *      the run arrays are allocated to fit exactly
+ ************************/
+Bit2RLE_T Bit2RLE_from_bit2(Bit2_T B2) {
+        Bit2RLE_T B = Bit2RLE_new(Bit2_width(B2), Bit2_height(B2));
+        Bit2_map_rows_span(B2, add_row_runs, B);
+
+        /* every row is complete, so trim the arrays to fit */
+        for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                struct row_runs *r = &B->rows[row_idx];
+                if (r->count > 0 && r->count < r->capacity) {
+                        int *runs = realloc(r->runs, (size_t)r->count * 2 *
+                                                     sizeof(int));
+                        assert(runs != NULL);
+                        r->runs = runs;
+                        r->capacity = r->count;
+                }
+        }
+        return B;
+}
+
+/********** Bit2RLE_to_bit2 ********
+ *
+ * Creates a dense Bit2 holding the same bits as a Bit2RLE.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *
+ * Return: A new Bit2_T, to be freed with Bit2_free.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ *      fills each run a word at a time
+ ************************/
+Bit2_T Bit2RLE_to_bit2(Bit2RLE_T B) {
+        assert(B != NULL);
+        Bit2_T B2 = Bit2_new(B->width, B->height);
+        for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                struct row_runs *r = &B->rows[row_idx];
+                for (int k = 0; k < r->count; k++) {
+                        set_range(B2, row_idx, r->runs[2 * k],
+                                  r->runs[2 * k + 1]);
+                }
+        }
+        return B2;
+}
+
+/********** Bit2RLE_memory ********
+ *
+ * Returns the number of bytes of memory the Bit2RLE occupies.
+ *
+ * Parameters:
+ *      Bit2RLE_T B: a pointer to a Bit2RLE_T struct
+ *
+ * Return: The bytes allocated for the struct, the table of rows, and the
+ *         run arrays, counting unused capacity.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+size_t Bit2RLE_memory(Bit2RLE_T B) {
+        assert(B != NULL);
+        size_t bytes = sizeof(*B) +
+                       ((size_t)B->height + 1) * sizeof(struct row_runs);
+        for (int row_idx = 0; row_idx < B->height; row_idx++) {
+                bytes += (size_t)B->rows[row_idx].capacity * 2 * sizeof(int);
+        }
+        return bytes;
+}
+
+/********** Bit2RLE_free ********
+ *
+ * Frees the memory allocated for a Bit2RLE.
+ *
+ * Parameters:
+ *      Bit2RLE_T *B: a pointer to a pointer to a Bit2RLE_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B and *B are not NULL
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      sets *B to NULL
+ ************************/
+void Bit2RLE_free(Bit2RLE_T *B) {
+        assert(B != NULL);
+        assert(*B != NULL);
+        for (int row_idx = 0; row_idx < (*B)->height; row_idx++) {
+                free((*B)->rows[row_idx].runs);
+        }
+        free((*B)->rows);
+        free(*B);
+        *B = NULL;
+}
+
+/********** upper_bound ********
+ *
+ * Finds the first run of a row that starts after a column.
+ *
+ * Parameters:
+ *      struct row_runs *r: the runs of the row
+ *      int col: the column
+ *
+ * Return: The index of the first run whose start is greater than col, or the
+ *         number of runs if there is none. The run before it, if any, is the
+ *         only one that can contain col.
+ ************************/
+static int upper_bound(struct row_runs *r, int col) {
+        int lo = 0;
+        int hi = r->count;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (r->runs[2 * mid] <= col) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        return lo;
+}
+
+/********** insert_run ********
+ *
+ * Inserts a run into the runs of a row, growing the array if it is full.
+ *
+ * Parameters:
+ *      struct row_runs *r: the runs of the row
+ *      int pos: the index the new run will have
+ *      int start, int end: the run, end exclusive
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      the runs stay sorted and apart once the run is inserted
+ *      the memory can be allocated
+ * Notes:
+ *      calls a CRE if the memory cannot be allocated
+ ************************/
+static void insert_run(struct row_runs *r, int pos, int start, int end) {
+        if (r->count == r->capacity) {
+                int capacity = (r->capacity == 0) ? 4 : 2 * r->capacity;
+                int *runs = realloc(r->runs,
+                                    (size_t)capacity * 2 * sizeof(int));
+                assert(runs != NULL);
+                r->runs = runs;
+                r->capacity = capacity;
+        }
+        memmove(&r->runs[2 * (pos + 1)], &r->runs[2 * pos],
+                (size_t)(r->count - pos) * 2 * sizeof(int));
+        r->runs[2 * pos] = start;
+        r->runs[2 * pos + 1] = end;
+        r->count++;
+}
+
+/********** remove_run ********
+ *
+ * Removes a run from the runs of a row.
+ *
+ * Parameters:
+ *      struct row_runs *r: the runs of the row
+ *      int pos: the index of the run to remove
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void remove_run(struct row_runs *r, int pos) {
+        memmove(&r->runs[2 * pos], &r->runs[2 * (pos + 1)],
+                (size_t)(r->count - pos - 1) * 2 * sizeof(int));
+        r->count--;
+}
+
+/********** add_row_runs ********
+ *
+ * Appends the runs of 1 bits in one row of a dense Bit2 to a Bit2RLE.
+ *
+ * Parameters:
+ *      int row: index of the row
+ *      uint64_t *words: the packed bits of the row
+ *      int count: the number of bits in the row
+ *      void *cl: the Bit2RLE_T to append to
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Called by Bit2_map_rows_span for each row. Alternately finds the next
+ *      1 bit and the next 0 bit after it by skipping whole words of 0s (or
+ *      1s) and using count-trailing-zeros within a word.
+ ************************/
+static void add_row_runs(int row, uint64_t *words, int count, void *cl) {
+        struct row_runs *r = &((Bit2RLE_T)cl)->rows[row];
+        int nwords = (count + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        int w = 0;
+        uint64_t ones = words[0];
+        for (;;) {
+                /* find the start of the next run */
+                while (ones == 0) {
+                        if (++w == nwords) {
+                                return;
+                        }
+                        ones = words[w];
+                }
+                int start = w * BITS_PER_WORD + __builtin_ctzll(ones);
+
+                /* find its end: the next 0 bit at or after start */
+                uint64_t zeros = ~words[w] &
+                                 (~(uint64_t)0 << (start % BITS_PER_WORD));
+                while (zeros == 0 && ++w < nwords) {
+                        zeros = ~words[w];
+                }
+                int end = (w == nwords) ? count
+                                        : w * BITS_PER_WORD +
+                                          __builtin_ctzll(zeros);
+                if (end > count) {
+                        end = count;
+                }
+                insert_run(r, r->count, start, end);
+                if (end >= count) {
+                        return;
+                }
+
+                /* the rest of the word after end */
+                w = end / BITS_PER_WORD;
+                ones = words[w] & (~(uint64_t)0 << (end % BITS_PER_WORD));
+        }
+}
+
+/********** set_range ********
+ *
+ * Sets the bits of a Bit2 row from column start up to (not including) end,
+ * a word at a time.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int row: the row
+ *      int start, int end: the columns, end exclusive
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void set_range(Bit2_T B2, int row, int start, int end) {
+        while (start < end) {
+                int w = start / BITS_PER_WORD;
+                int lo = start % BITS_PER_WORD;
+                int hi = (end - w * BITS_PER_WORD < BITS_PER_WORD)
+                         ? end - w * BITS_PER_WORD : BITS_PER_WORD;
+                uint64_t mask = (hi == BITS_PER_WORD) ? ~(uint64_t)0
+                                : ((uint64_t)1 << hi) - 1;
+                mask &= ~(uint64_t)0 << lo;
+                Bit2_put_word(B2, w, row, Bit2_get_word(B2, w, row) | mask);
+                start = w * BITS_PER_WORD + hi;
+        }
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ *
+ *                     bit2rle.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file is the interface for the Bit2RLE data structure, a
+ *     2-dimensional array of bits stored as runs. It offers the same
+ *     operations as Bit2 (new, width, height, get, put, row-major and
+ *     column-major maps, free), but keeps, for each row, only a sorted list of
+ *     the runs of 1 bits in it. A mostly white page therefore costs memory in
+ *     proportion to its ink rather than its area, at the price of slower
+ *     random access: Bit2RLE_get and Bit2RLE_put search the runs of a row,
+ *     and Bit2RLE_put may have to shift them.
+ *
+ *     Bit2RLE_map_runs visits the runs themselves, one call per run of 1
+ *     bits, which is the fast way to traverse a sparse image. Bit2RLE_from_bit2
+ *     and Bit2RLE_to_bit2 convert to and from a dense Bit2, and
+ *     Bit2RLE_memory reports how many bytes a Bit2RLE occupies. In this file,
+ *     we typedef Bit2RLE_T to be a pointer to a Bit2RLE_T struct, as defined
+ *     in the implementation.
+ *
+ ******************************************************************************/
+#ifndef BIT2RLE_INCLUDED
+#define BIT2RLE_INCLUDED
+
+#include <stddef.h>
+#include "bit2.h"
+
+typedef struct Bit2RLE_T *Bit2RLE_T;
+
+Bit2RLE_T Bit2RLE_new(int width, int height);
+extern int Bit2RLE_width(Bit2RLE_T B);
+extern int Bit2RLE_height(Bit2RLE_T B);
+extern int Bit2RLE_get(Bit2RLE_T B, int col, int row);
+extern int Bit2RLE_put(Bit2RLE_T B, int col, int row, int bit);
+extern void Bit2RLE_map_col_major(Bit2RLE_T B,
+                                  void apply(int col, int row, Bit2RLE_T B,
+                                             int val, void *cl),
+                                  void *cl);
+extern void Bit2RLE_map_row_major(Bit2RLE_T B,
+                                  void apply(int col, int row, Bit2RLE_T B,
+                                             int val, void *cl),
+                                  void *cl);
+extern void Bit2RLE_map_runs(Bit2RLE_T B,
+                             void apply(int row, int start, int length,
+                                        void *cl),
+                             void *cl);
+extern int Bit2RLE_row_runs(Bit2RLE_T B, int row);
+Bit2RLE_T Bit2RLE_from_bit2(Bit2_T B2);
+Bit2_T Bit2RLE_to_bit2(Bit2RLE_T B);
+extern size_t Bit2RLE_memory(Bit2RLE_T B);
+extern void Bit2RLE_free(Bit2RLE_T *B);
+
+#endif
@@ -0,0 +1,861 @@
+/*******************************************************************************
+ *
+ *                     bit2roar.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of the Bit2Roar data structure.
+ *     The image is cut into TILE x TILE tiles, stored in row-major order of
+ *     tiles. Within a tile, the bit at (col, row) has position
+ *     (row % TILE) * TILE + col % TILE, so that row r of a tile is word r of
+ *     its bitmap and lines up with one word of the matching Bit2 row. Each
+ *     tile is one of four kinds of container:
+ *
+ *         KIND_EMPTY   no 1 bits, and no memory
+ *         KIND_ARRAY   a sorted array of the positions of the 1 bits, used
+ *                      for at most ARRAY_MAX of them (beyond that a bitmap
+ *                      is smaller)
+ *         KIND_BITMAP  TILE_WORDS words of bits
+ *         KIND_RUN     a sorted array of (start, length) pairs of positions,
+ *                      used when it is the smallest of the three
+ *
+ *     Whenever a tile is rebuilt from scratch (by pack), it gets the smallest
+ *     container for its contents. Bit2Roar_put only converts between arrays
+ *     and bitmaps, so that a single put never has to split or rebuild runs:
+ *     a run tile that is written to becomes an array or a bitmap first. A
+ *     bitmap only goes back to an array once it drops to ARRAY_MAX / 2 bits,
+ *     so that bits flipping around the threshold do not convert the tile
+ *     back and forth.
+ *
+ ******************************************************************************/
+#include "bit2roar.h"
+#include "except.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define TILE 64
+#define TILE_WORDS 64           /* one word per row of a tile */
+#define TILE_BITS (TILE * TILE)
+#define ARRAY_MAX 256           /* 2-byte positions; 256 of them = a bitmap */
+
+enum { KIND_EMPTY, KIND_ARRAY, KIND_BITMAP, KIND_RUN };
+
+struct tile {
+        uint8_t kind;
+        uint16_t card;          /* number of 1 bits */
+        uint16_t n;             /* positions or runs in data */
+        uint16_t capacity;      /* positions or runs data has room for */
+        void *data;
+};
+
+struct Bit2Roar_T {
+        int width;
+        int height;
+        int tiles_wide;
+        int tiles_high;
+        struct tile *tiles;
+};
+
+static struct tile *tile_at(Bit2Roar_T B, int col, int row);
+static int tile_get(const struct tile *t, int pos);
+static void expand(const struct tile *t, uint64_t words[TILE_WORDS]);
+static void pack(struct tile *t, const uint64_t words[TILE_WORDS],
+                 int allow_runs);
+static int next_bit(const uint64_t words[TILE_WORDS], int pos, int bit);
+static void clone(struct tile *dst, const struct tile *src);
+static void release(struct tile *t);
+static void array_insert(struct tile *t, int pos);
+static void array_remove(struct tile *t, int pos);
+static size_t tile_bytes(const struct tile *t);
+
+/********** Bit2Roar_new ********
+ *
+ * Allocates, initializes, and returns a new Bit2Roar_T.
+ *
+ * Parameters:
+ *      int width:  an integer for the width of the Bit2Roar_T
+ *      int height: an integer for the height of the Bit2Roar_T
+ *
+ * Return: Returns the newly created Bit2Roar_T struct.
+ *
+ * Expects
+ *      width and height are non-negative
+ *      the memory can be allocated
+ * Notes:
+ *      will call a CRE if the above expectations are not met
+ *      the memory associated with B is freed using Bit2Roar_free
+ *      every bit starts out as 0, and every tile starts out empty
+ ************************/
+Bit2Roar_T Bit2Roar_new(int width, int height) {
+        assert(width >= 0);
+        assert(height >= 0);
+
+        Bit2Roar_T B = malloc(sizeof(*B));
+        assert(B != NULL);
+        B->width = width;
+        B->height = height;
+        B->tiles_wide = width / TILE + (width % TILE != 0);
+        B->tiles_high = height / TILE + (height % TILE != 0);
+        /* one spare tile so that an empty Bit2Roar still gets an allocation */
+        B->tiles = calloc((size_t)B->tiles_wide * B->tiles_high + 1,
+                          sizeof(struct tile));
+        assert(B->tiles != NULL);
+        return B;
+}
+
+/********** Bit2Roar_width ********
+ *
+ * Returns the width of the Bit2Roar_T struct.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: Returns the width of the Bit2Roar_T struct.
+ *
+ * Expects
+ *      B to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+int Bit2Roar_width(Bit2Roar_T B) {
+        assert(B != NULL);
+        return B->width;
+}
+
+/********** Bit2Roar_height ********
+ *
+ * Returns the height of the Bit2Roar_T struct.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: Returns the height of the Bit2Roar_T struct.
+ *
+ * Expects
+ *      B to not be NULL
+ * Notes:
+ *      Will call a CRE if the above expectations are not met.
+ ************************/
+int Bit2Roar_height(Bit2Roar_T B) {
+        assert(B != NULL);
+        return B->height;
+}
+
+/********** Bit2Roar_get ********
+ *
+ * Returns the value of the bit at the given index.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *      int col: the column of the index of the bit
+ *      int row: the row of the index of the bit
+ *
+ * Return: The value of the bit at the given index.
+ *
+ * Expects
+ *      B is not NULL
+ *      col and row are non-negative
+ *      col is less than the width and row is less than the height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      takes constant time for an empty or bitmap tile, and time logarithmic
+ *      in the size of the container otherwise
+ ************************/
+int Bit2Roar_get(Bit2Roar_T B, int col, int row) {
+        assert(B != NULL);
+        assert(col >= 0 && col < B->width);
+        assert(row >= 0 && row < B->height);
+        return tile_get(tile_at(B, col, row),
+                        (row % TILE) * TILE + col % TILE);
+}
+
+/********** Bit2Roar_put ********
+ *
+ * Inserts the given value at the index and returns the previous value.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *      int col: the column of the index of the bit
+ *      int row: the row of the index of the bit
+ *      int bit: the value that is to be inserted
+ *
+ * Return: The value of the previous bit at the given index.
+ *
+ * Expects
+ *      B is not NULL
+ *      col and row are non-negative
+ *      col is less than the width and row is less than the height
+ *      the bit value to be inserted is either 0 or 1
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      may convert the tile between an array and a bitmap, and turns a run
+ *      tile that changes into an array or bitmap
+ ************************/
+int Bit2Roar_put(Bit2Roar_T B, int col, int row, int bit) {
+        assert(B != NULL);
+        assert(col >= 0 && col < B->width);
+        assert(row >= 0 && row < B->height);
+        assert(bit == 1 || bit == 0);
+
+        struct tile *t = tile_at(B, col, row);
+        int pos = (row % TILE) * TILE + col % TILE;
+        int prev = tile_get(t, pos);
+        if (prev == bit) {
+                return prev;
+        }
+
+        uint64_t words[TILE_WORDS];
+        if (t->kind == KIND_RUN) {
+                expand(t, words);
+                pack(t, words, 0);
+        }
+
+        if (t->kind == KIND_BITMAP) {
+                uint64_t *bits = t->data;
+                bits[pos / 64] ^= (uint64_t)1 << (pos % 64);
+                t->card += bit ? 1 : -1;
+                if (t->card <= ARRAY_MAX / 2) {
+                        expand(t, words);
+                        pack(t, words, 0);
+                }
+        } else if (bit == 1 && t->n == ARRAY_MAX) {
+                expand(t, words);
+                words[pos / 64] |= (uint64_t)1 << (pos % 64);
+                pack(t, words, 0);
+        } else if (bit == 1) {
+                array_insert(t, pos);
+        } else {
+                array_remove(t, pos);
+        }
+        return prev;
+}
+
+/********** Bit2Roar_map_set_bits ********
+ *
+ * Calls the given apply function at every index whose bit is 1.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *      it at each set bit
+ *      void *cl: a void pointer to be determined by the client
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B is not NULL
+ *      apply does not change the Bit2Roar
+ * Notes:
+ *      calls a CRE if the first expectation is not met
+ *      visits the tiles in row-major order of tiles, and the bits of each
+ *      tile in row-major order within the tile; empty tiles cost nothing
+ ************************/
+void Bit2Roar_map_set_bits(Bit2Roar_T B,
+                           void apply(int col, int row, Bit2Roar_T B,
+                                      void *cl),
+                           void *cl) {
+        assert(B != NULL);
+        struct tile *t = B->tiles;
+        for (int tile_row = 0; tile_row < B->tiles_high; tile_row++) {
+                for (int tile_col = 0; tile_col < B->tiles_wide;
+                     tile_col++, t++) {
+                        int col0 = tile_col * TILE;
+                        int row0 = tile_row * TILE;
+                        if (t->kind == KIND_ARRAY) {
+                                uint16_t *p = t->data;
+                                for (int i = 0; i < t->n; i++) {
+                                        apply(col0 + p[i] % TILE,
+                                              row0 + p[i] / TILE, B, cl);
+                                }
+                        } else if (t->kind == KIND_BITMAP) {
+                                uint64_t *bits = t->data;
+                                for (int w = 0; w < TILE_WORDS; w++) {
+                                        uint64_t x = bits[w];
+                                        while (x != 0) {
+                                                apply(col0 +
+                                                      __builtin_ctzll(x),
+                                                      row0 + w, B, cl);
+                                                x &= x - 1;
+                                        }
+                                }
+                        } else if (t->kind == KIND_RUN) {
+                                uint16_t *r = t->data;
+                                for (int i = 0; i < t->n; i++) {
+                                        int end = r[2 * i] + r[2 * i + 1];
+                                        for (int p = r[2 * i]; p < end; p++) {
+                                                apply(col0 + p % TILE,
+                                                      row0 + p / TILE, B, cl);
+                                        }
+                                }
+                        }
+                }
+        }
+}
+
+/********** Bit2Roar_and ********
+ *
+ * Creates a new Bit2Roar holding the AND of two others.
+ *
+ * Parameters:
+ *      Bit2Roar_T a, Bit2Roar_T b: pointers to the Bit2Roar_T structs to
+ *      combine
+ *
+ * Return: A new Bit2Roar_T, to be freed with Bit2Roar_free.
+ *
+ * Expects
+ *      a and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      a tile that is empty in either grid is skipped, a tile that is full
+ *      in one grid is copied from the other, and an array tile is combined
+ *      by testing each of its positions in the other grid; other tiles are
+ *      combined a word at a time
+ ************************/
+Bit2Roar_T Bit2Roar_and(Bit2Roar_T a, Bit2Roar_T b) {
+        assert(a != NULL && b != NULL);
+        assert(a->width == b->width && a->height == b->height);
+
+        Bit2Roar_T result = Bit2Roar_new(a->width, a->height);
+        size_t ntiles = (size_t)a->tiles_wide * a->tiles_high;
+        for (size_t i = 0; i < ntiles; i++) {
+                struct tile *ta = &a->tiles[i];
+                struct tile *tb = &b->tiles[i];
+                if (ta->kind == KIND_EMPTY || tb->kind == KIND_EMPTY) {
+                        continue;
+                }
+                if (ta->card == TILE_BITS || tb->card == TILE_BITS) {
+                        clone(&result->tiles[i],
+                              (ta->card == TILE_BITS) ? tb : ta);
+                        continue;
+                }
+
+                uint64_t wa[TILE_WORDS];
+                if (ta->kind == KIND_ARRAY || tb->kind == KIND_ARRAY) {
+                        struct tile *small = (ta->kind == KIND_ARRAY) ? ta
+                                                                      : tb;
+                        struct tile *other = (small == ta) ? tb : ta;
+                        uint16_t *p = small->data;
+                        memset(wa, 0, sizeof(wa));
+                        for (int k = 0; k < small->n; k++) {
+                                if (tile_get(other, p[k])) {
+                                        wa[p[k] / 64] |= (uint64_t)1 <<
+                                                         (p[k] % 64);
+                                }
+                        }
+                } else {
+                        uint64_t wb[TILE_WORDS];
+                        expand(ta, wa);
+                        expand(tb, wb);
+                        for (int w = 0; w < TILE_WORDS; w++) {
+                                wa[w] &= wb[w];
+                        }
+                }
+                pack(&result->tiles[i], wa, 1);
+        }
+        return result;
+}
+
+/********** Bit2Roar_or ********
+ *
+ * Creates a new Bit2Roar holding the OR of two others.
+ *
+ * Parameters:
+ *      Bit2Roar_T a, Bit2Roar_T b: pointers to the Bit2Roar_T structs to
+ *      combine
+ *
+ * Return: A new Bit2Roar_T, to be freed with Bit2Roar_free.
+ *
+ * Expects
+ *      a and b are not NULL and have the same width and height
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      a tile is copied from one grid when it is full there or empty in the
+ *      other; other tiles are combined a word at a time
+ ************************/
+Bit2Roar_T Bit2Roar_or(Bit2Roar_T a, Bit2Roar_T b) {
+        assert(a != NULL && b != NULL);
+        assert(a->width == b->width && a->height == b->height);
+
+        Bit2Roar_T result = Bit2Roar_new(a->width, a->height);
+        size_t ntiles = (size_t)a->tiles_wide * a->tiles_high;
+        for (size_t i = 0; i < ntiles; i++) {
+                struct tile *ta = &a->tiles[i];
+                struct tile *tb = &b->tiles[i];
+                if (tb->kind == KIND_EMPTY || ta->card == TILE_BITS) {
+                        clone(&result->tiles[i], ta);
+                } else if (ta->kind == KIND_EMPTY || tb->card == TILE_BITS) {
+                        clone(&result->tiles[i], tb);
+                } else {
+                        uint64_t wa[TILE_WORDS], wb[TILE_WORDS];
+                        expand(ta, wa);
+                        expand(tb, wb);
+                        for (int w = 0; w < TILE_WORDS; w++) {
+                                wa[w] |= wb[w];
+                        }
+                        pack(&result->tiles[i], wa, 1);
+                }
+        }
+        return result;
+}
+
+/********** Bit2Roar_popcount ********
+ *
+ * Counts the bits set in the whole Bit2Roar_T.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: The number of bits that are 1.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ *      each tile keeps its own count, so this takes time proportional to the
+ *      number of tiles
+ ************************/
+size_t Bit2Roar_popcount(Bit2Roar_T B) {
+        assert(B != NULL);
+        size_t count = 0;
+        size_t ntiles = (size_t)B->tiles_wide * B->tiles_high;
+        for (size_t i = 0; i < ntiles; i++) {
+                count += B->tiles[i].card;
+        }
+        return count;
+}
+
+/********** Bit2Roar_optimize ********
+ *
+ * Stores every tile in the smallest container for its contents.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ *      worth calling after many calls to Bit2Roar_put, which never creates
+ *      run tiles
+ ************************/
+void Bit2Roar_optimize(Bit2Roar_T B) {
+        assert(B != NULL);
+        size_t ntiles = (size_t)B->tiles_wide * B->tiles_high;
+        for (size_t i = 0; i < ntiles; i++) {
+                if (B->tiles[i].kind != KIND_EMPTY) {
+                        uint64_t words[TILE_WORDS];
+                        expand(&B->tiles[i], words);
+                        pack(&B->tiles[i], words, 1);
+                }
+        }
+}
+
+/********** Bit2Roar_from_bit2 ********
+ *
+ * Creates a Bit2Roar holding the same bits as a dense Bit2.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: A new Bit2Roar_T, to be freed with Bit2Roar_free.
+ *
+ * Expects
+ *      B2 is not NULL
+ *      the width and height of B2 each fit in an int
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      each row of a tile is one word of the Bit2, so tiles are copied a word
+ *      at a time, and each gets the smallest container for its contents
+ ************************/
+Bit2Roar_T Bit2Roar_from_bit2(Bit2_T B2) {
+        Bit2Roar_T B = Bit2Roar_new(Bit2_width(B2), Bit2_height(B2));
+        struct tile *t = B->tiles;
+        for (int tile_row = 0; tile_row < B->tiles_high; tile_row++) {
+                int row0 = tile_row * TILE;
+                int rows = (B->height - row0 < TILE) ? B->height - row0
+                                                     : TILE;
+                for (int tile_col = 0; tile_col < B->tiles_wide;
+                     tile_col++, t++) {
+                        uint64_t words[TILE_WORDS] = {0};
+                        uint64_t any = 0;
+                        for (int r = 0; r < rows; r++) {
+                                words[r] = Bit2_get_word(B2, tile_col,
+                                                         row0 + r);
+                                any |= words[r];
+                        }
+                        if (any != 0) {
+                                pack(t, words, 1);
+                        }
+                }
+        }
+        return B;
+}
+
+/********** Bit2Roar_to_bit2 ********
+ *
+ * Creates a dense Bit2 holding the same bits as a Bit2Roar.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: A new Bit2_T, to be freed with Bit2_free.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+Bit2_T Bit2Roar_to_bit2(Bit2Roar_T B) {
+        assert(B != NULL);
+        Bit2_T B2 = Bit2_new(B->width, B->height);
+        struct tile *t = B->tiles;
+        for (int tile_row = 0; tile_row < B->tiles_high; tile_row++) {
+                int row0 = tile_row * TILE;
+                int rows = (B->height - row0 < TILE) ? B->height - row0
+                                                     : TILE;
+                for (int tile_col = 0; tile_col < B->tiles_wide;
+                     tile_col++, t++) {
+                        if (t->kind == KIND_EMPTY) {
+                                continue;
+                        }
+                        uint64_t words[TILE_WORDS];
+                        expand(t, words);
+                        for (int r = 0; r < rows; r++) {
+                                Bit2_put_word(B2, tile_col, row0 + r,
+                                              words[r]);
+                        }
+                }
+        }
+        return B2;
+}
+
+/********** Bit2Roar_memory ********
+ *
+ * Returns the number of bytes of memory the Bit2Roar occupies.
+ *
+ * Parameters:
+ *      Bit2Roar_T B: a pointer to a Bit2Roar_T struct
+ *
+ * Return: The bytes allocated for the struct, the table of tiles, and the
+ *         containers, counting unused capacity.
+ *
+ * Expects
+ *      B is not NULL
+ * Notes:
+ *      calls a CRE if the above expectation is not met
+ ************************/
+size_t Bit2Roar_memory(Bit2Roar_T B) {
+        assert(B != NULL);
+        size_t ntiles = (size_t)B->tiles_wide * B->tiles_high;
+        size_t bytes = sizeof(*B) + (ntiles + 1) * sizeof(struct tile);
+        for (size_t i = 0; i < ntiles; i++) {
+                bytes += tile_bytes(&B->tiles[i]);
+        }
+        return bytes;
+}
+
+/********** Bit2Roar_free ********
+ *
+ * Frees the memory allocated for a Bit2Roar.
+ *
+ * Parameters:
+ *      Bit2Roar_T *B: a pointer to a pointer to a Bit2Roar_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      B and *B are not NULL
+ * Notes:
+ *      calls a CRE if any of the above expectations are not met
+ *      sets *B to NULL
+ ************************/
+void Bit2Roar_free(Bit2Roar_T *B) {
+        assert(B != NULL);
+        assert(*B != NULL);
+        size_t ntiles = (size_t)(*B)->tiles_wide * (*B)->tiles_high;
+        for (size_t i = 0; i < ntiles; i++) {
+                release(&(*B)->tiles[i]);
+        }
+        free((*B)->tiles);
+        free(*B);
+        *B = NULL;
+}
+
+/********** tile_at ********
+ *
+ * Returns the tile holding the bit at (col, row), which must be in bounds.
+ ************************/
+static struct tile *tile_at(Bit2Roar_T B, int col, int row) {
+        return &B->tiles[(size_t)(row / TILE) * B->tiles_wide + col / TILE];
+}
+
+/********** tile_get ********
+ *
+ * Returns the bit at a position within a tile.
+ *
+ * Parameters:
+ *      const struct tile *t: the tile
+ *      int pos: the position, (row % TILE) * TILE + col % TILE
+ *
+ * Return: The value of the bit.
+ ************************/
+static int tile_get(const struct tile *t, int pos) {
+        if (t->kind == KIND_BITMAP) {
+                const uint64_t *bits = t->data;
+                return (bits[pos / 64] >> (pos % 64)) & 1;
+        }
+        if (t->kind == KIND_EMPTY) {
+                return 0;
+        }
+
+        /* binary search for the last entry starting at or before pos */
+        const uint16_t *p = t->data;
+        int step = (t->kind == KIND_RUN) ? 2 : 1;
+        int lo = 0;
+        int hi = t->n;
+        while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (p[step * mid] <= pos) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+        if (lo == 0) {
+                return 0;
+        }
+        const uint16_t *e = &p[step * (lo - 1)];
+        return (t->kind == KIND_RUN) ? pos < e[0] + e[1] : e[0] == pos;
+}
+
+/********** expand ********
+ *
+ * Writes the bits of a tile, whatever its container, as TILE_WORDS words.
+ *
+ * Parameters:
+ *      const struct tile *t: the tile
+ *      uint64_t words[]: where to write the words
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void expand(const struct tile *t, uint64_t words[TILE_WORDS]) {
+        if (t->kind == KIND_BITMAP) {
+                memcpy(words, t->data, TILE_WORDS * sizeof(uint64_t));
+                return;
+        }
+        memset(words, 0, TILE_WORDS * sizeof(uint64_t));
+        const uint16_t *p = t->data;
+        if (t->kind == KIND_ARRAY) {
+                for (int i = 0; i < t->n; i++) {
+                        words[p[i] / 64] |= (uint64_t)1 << (p[i] % 64);
+                }
+        } else if (t->kind == KIND_RUN) {
+                for (int i = 0; i < t->n; i++) {
+                        int pos = p[2 * i];
+                        int end = pos + p[2 * i + 1];
+                        while (pos < end) {
+                                int bit = pos % 64;
+                                int n = (end - pos < 64 - bit) ? end - pos
+                                                               : 64 - bit;
+                                uint64_t ones = (n == 64) ? ~(uint64_t)0
+                                                : ((uint64_t)1 << n) - 1;
+                                words[pos / 64] |= ones << bit;
+                                pos += n;
+                        }
+                }
+        }
+}
+
+/********** pack ********
+ *
+ * Rebuilds a tile from TILE_WORDS words, in the smallest container for them.
+ *
+ * Parameters:
+ *      struct tile *t: the tile, whose old container is released
+ *      const uint64_t words[]: the bits of the tile; must not be the tile's
+ *      own data
+ *      int allow_runs: 0 to choose only between an array and a bitmap
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      calls a CRE if the memory cannot be allocated
+ *      an array takes 2 bytes per 1 bit, a bitmap TILE_BITS / 8 bytes, and a
+ *      run list 4 bytes per run
+ ************************/
+static void pack(struct tile *t, const uint64_t words[TILE_WORDS],
+                 int allow_runs) {
+        int card = 0;
+        int runs = 0;
+        uint64_t carry = 0;
+        for (int w = 0; w < TILE_WORDS; w++) {
+                card += __builtin_popcountll(words[w]);
+                /* a run starts at each 1 whose predecessor is 0 */
+                runs += __builtin_popcountll(words[w] &
+                                             ~((words[w] << 1) | carry));
+                carry = words[w] >> 63;
+        }
+        release(t);
+        if (card == 0) {
+                return;
+        }
+
+        size_t array_bytes = 2 * (size_t)card;
+        size_t bitmap_bytes = TILE_BITS / 8;
+        size_t run_bytes = 4 * (size_t)runs;
+        t->card = card;
+        if (allow_runs && run_bytes < array_bytes &&
+            run_bytes < bitmap_bytes) {
+                uint16_t *r = malloc(run_bytes);
+                assert(r != NULL);
+                int n = 0;
+                int pos = next_bit(words, 0, 1);
+                while (pos < TILE_BITS) {
+                        int end = next_bit(words, pos, 0);
+                        r[2 * n] = pos;
+                        r[2 * n + 1] = end - pos;
+                        n++;
+                        pos = next_bit(words, end, 1);
+                }
+                t->kind = KIND_RUN;
+                t->data = r;
+                t->n = t->capacity = n;
+        } else if (card <= ARRAY_MAX) {
+                uint16_t *p = malloc(array_bytes);
+                assert(p != NULL);
+                int n = 0;
+                for (int w = 0; w < TILE_WORDS; w++) {
+                        uint64_t x = words[w];
+                        while (x != 0) {
+                                p[n++] = w * 64 + __builtin_ctzll(x);
+                                x &= x - 1;
+                        }
+                }
+                t->kind = KIND_ARRAY;
+                t->data = p;
+                t->n = t->capacity = n;
+        } else {
+                uint64_t *bits = malloc(bitmap_bytes);
+                assert(bits != NULL);
+                memcpy(bits, words, bitmap_bytes);
+                t->kind = KIND_BITMAP;
+                t->data = bits;
+        }
+}
+
+/********** next_bit ********
+ *
+ * Returns the first position at or after pos whose bit has the given value,
+ * or TILE_BITS if there is none.
+ ************************/
+static int next_bit(const uint64_t words[TILE_WORDS], int pos, int bit) {
+        uint64_t flip = bit ? 0 : ~(uint64_t)0;
+        if (pos >= TILE_BITS) {
+                return TILE_BITS;
+        }
+        int w = pos / 64;
+        uint64_t x = (words[w] ^ flip) & (~(uint64_t)0 << (pos % 64));
+        while (x == 0) {
+                if (++w == TILE_WORDS) {
+                        return TILE_BITS;
+                }
+                x = words[w] ^ flip;
+        }
+        return w * 64 + __builtin_ctzll(x);
+}
+
+/********** clone ********
+ *
+ * Makes an empty tile a copy of another, with its own container.
+ ************************/
+static void clone(struct tile *dst, const struct tile *src) {
+        *dst = *src;
+        if (src->kind == KIND_EMPTY) {
+                return;
+        }
+        size_t bytes = (src->kind == KIND_BITMAP) ? TILE_BITS / 8
+                       : (size_t)src->n *
+                         ((src->kind == KIND_RUN) ? 4 : 2);
+        dst->data = malloc(bytes);
+        assert(dst->data != NULL);
+        memcpy(dst->data, src->data, bytes);
+        if (src->kind != KIND_BITMAP) {
+                dst->capacity = src->n;
+        }
+}
+
+/********** release ********
+ *
+ * Frees the container of a tile and leaves the tile empty.
+ ************************/
+static void release(struct tile *t) {
+        free(t->data);
+        memset(t, 0, sizeof(*t));
+}
+
+/********** array_insert ********
+ *
+ * Inserts a position that is not yet present into an empty or array tile
+ * with fewer than ARRAY_MAX positions, growing the array if it is full.
+ ************************/
+static void array_insert(struct tile *t, int pos) {
+        if (t->n == t->capacity) {
+                int capacity = (t->capacity == 0) ? 4 : 2 * t->capacity;
+                if (capacity > ARRAY_MAX) {
+                        capacity = ARRAY_MAX;
+                }
+                uint16_t *p = realloc(t->data, (size_t)capacity * 2);
+                assert(p != NULL);
+                t->data = p;
+                t->capacity = capacity;
+        }
+        uint16_t *p = t->data;
+        int i = t->n;
+        while (i > 0 && p[i - 1] > pos) {
+                p[i] = p[i - 1];
+                i--;
+        }
+        p[i] = pos;
+        t->n++;
+        t->card++;
+        t->kind = KIND_ARRAY;
+}
+
+/********** array_remove ********
+ *
+ * Removes a position that is present from an array tile, leaving the tile
+ * empty if it was the last one.
+ ************************/
+static void array_remove(struct tile *t, int pos) {
+        uint16_t *p = t->data;
+        int i = 0;
+        while (p[i] != pos) {
+                i++;
+        }
+        memmove(&p[i], &p[i + 1], (size_t)(t->n - i - 1) * 2);
+        t->n--;
+        t->card--;
+        if (t->n == 0) {
+                release(t);
+        }
+}
+
+/********** tile_bytes ********
+ *
+ * Returns the bytes allocated for the container of a tile.
+ ************************/
+static size_t tile_bytes(const struct tile *t) {
+        switch (t->kind) {
+        case KIND_ARRAY:        return (size_t)t->capacity * 2;
+        case KIND_BITMAP:       return TILE_BITS / 8;
+        case KIND_RUN:          return (size_t)t->capacity * 4;
+        default:                return 0;
+        }
+}
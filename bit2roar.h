@@ -0,0 +1,56 @@
+/*******************************************************************************
+ *
+ *                     bit2roar.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file is the interface for the Bit2Roar data structure, a
+ *     2-dimensional array of bits for images that mix dense and empty
+ *     regions, such as a scanned page with a photo beside wide margins. In
+ *     the style of a roaring bitmap, the image is cut into 64 x 64 tiles and
+ *     each tile is stored in whichever container suits its contents: nothing
+ *     at all for an empty tile, a sorted array of positions for a tile with
+ *     few 1 bits, a plain bitmap for a busy tile, or a list of runs for a
+ *     tile made of long stretches of 1s.
+ *
+ *     Bit2Roar provides new, width, height, get, put, and free like Bit2;
+ *     Bit2Roar_map_set_bits to visit the 1 bits, tile by tile; Bit2Roar_and
+ *     and Bit2Roar_or to combine two grids of the same shape into a new one;
+ *     and Bit2Roar_popcount. Bit2Roar_from_bit2 and Bit2Roar_to_bit2 convert
+ *     to and from a dense Bit2. Bit2Roar_put keeps to arrays and bitmaps, so
+ *     after many puts Bit2Roar_optimize can be called to pick the smallest
+ *     container for every tile again, runs included; the conversions and the
+ *     combining operations do so on their own. Bit2Roar_memory reports how
+ *     many bytes a Bit2Roar occupies. In this file, we typedef Bit2Roar_T to
+ *     be a pointer to a Bit2Roar_T struct, as defined in the implementation.
+ *
+ ******************************************************************************/
+#ifndef BIT2ROAR_INCLUDED
+#define BIT2ROAR_INCLUDED
+
+#include <stddef.h>
+#include "bit2.h"
+
+typedef struct Bit2Roar_T *Bit2Roar_T;
+
+Bit2Roar_T Bit2Roar_new(int width, int height);
+extern int Bit2Roar_width(Bit2Roar_T B);
+extern int Bit2Roar_height(Bit2Roar_T B);
+extern int Bit2Roar_get(Bit2Roar_T B, int col, int row);
+extern int Bit2Roar_put(Bit2Roar_T B, int col, int row, int bit);
+extern void Bit2Roar_map_set_bits(Bit2Roar_T B,
+                                  void apply(int col, int row, Bit2Roar_T B,
+                                             void *cl),
+                                  void *cl);
+Bit2Roar_T Bit2Roar_and(Bit2Roar_T a, Bit2Roar_T b);
+Bit2Roar_T Bit2Roar_or(Bit2Roar_T a, Bit2Roar_T b);
+extern size_t Bit2Roar_popcount(Bit2Roar_T B);
+extern void Bit2Roar_optimize(Bit2Roar_T B);
+Bit2Roar_T Bit2Roar_from_bit2(Bit2_T B2);
+Bit2_T Bit2Roar_to_bit2(Bit2Roar_T B);
+extern size_t Bit2Roar_memory(Bit2Roar_T B);
+extern void Bit2Roar_free(Bit2Roar_T *B);
+
+#endif
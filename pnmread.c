@@ -0,0 +1,971 @@
+/*******************************************************************************
+ *
+ *                     pnmread.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of Pnmread. The unread part of the
+ *     input is always the bytes from next up to end: for a regular file that is
+ *     the rest of a private mapping of the whole file, whose pages are unmapped
+ *     as rows are read so that reading a row at a time takes bounded memory
+ *     however large the file is, and for anything else it is the rest of a
+ *     buffer that is refilled from the file in blocks of BLOCK_SIZE bytes, and
+ *     grown if a single row will not fit. Raw rows are converted a word at a
+ *     time. Plain rows are scanned 8 bytes at a time in a uint64_t: the bytes
+ *     that are digits and the bytes that are whitespace are found with a few
+ *     word-wide operations, so a bitmap is packed without looking at its bytes
+ *     one by one, and a value of up to 8 digits in a graymap is converted with
+ *     three multiplies. Anything the word-wide scan does not expect, such as a
+ *     comment, is handled a byte at a time. On processors with AVX2 (and BMI2,
+ *     for a bitmap), plain rows are instead scanned 32 bytes at a time: each
+ *     byte is classed as a digit or whitespace with two 16-entry table lookups,
+ *     the pixels of a bitmap are pulled out of the digit mask with PEXT, and up
+ *     to four graymap values at a time are moved into place with a byte shuffle
+ *     and converted with a chain of multiply-adds.
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+
+#include "pnmread.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PNMREAD_X86 1
+#include <immintrin.h>
+#endif
+
+#define BLOCK_SIZE (1 << 20)
+
+/* a byte repeated in all 8 bytes of a word */
+#define BYTES(b) (0x0101010101010101u * (uint64_t)(b))
+
+struct Pnmread_T {
+        Pnmread_mapdata data;
+        int raw;                        /* P4 or P5 rather than P1 or P2 */
+        FILE *fp;                       /* read from when there is no map */
+        unsigned char *map;             /* the whole file, or NULL */
+        size_t map_length;
+        size_t unmapped;                /* bytes of the map already unmapped */
+        unsigned char *buffer;          /* the block, when there is no map */
+        size_t capacity;
+        const unsigned char *next;      /* the first unread byte */
+        const unsigned char *end;       /* one past the last byte read */
+        int at_eof;                     /* nothing more can be read */
+        size_t pixels_left;             /* pixels not yet returned */
+};
+
+/* each byte with its bits reversed, as raw bitmaps put the leftmost pixel
+   in the highest bit */
+static unsigned char reversed[256];
+
+static void read_header(Pnmread_T R);
+static unsigned read_number(Pnmread_T R);
+static size_t available(Pnmread_T R, size_t n);
+static void skip_space(Pnmread_T R);
+static void release_read(Pnmread_T R);
+static int is_space(int c);
+static void raw_bits(Pnmread_T R, Bit2_T B2, int row);
+static void plain_bits(Pnmread_T R, Bit2_T B2, int row);
+static int plain_pixel(Pnmread_T R);
+static void append_bits(Bit2_T B2, int row, uint64_t *word, int *col,
+                        uint64_t bits, int count);
+static void plain_values(Pnmread_T R, unsigned *values, int count);
+static unsigned plain_value(Pnmread_T R);
+static uint64_t load8(const unsigned char *p);
+static uint64_t zero_bytes(uint64_t x);
+static unsigned gather_bytes(uint64_t x);
+static unsigned parse8(uint64_t chunk, int digits);
+#if defined(PNMREAD_X86)
+static void classify_avx2(const unsigned char *p, uint32_t *digits,
+                          uint32_t *spaces);
+static void plain_bits_avx2(Pnmread_T R, Bit2_T B2, int row);
+static void plain_values_avx2(Pnmread_T R, unsigned *values, int count);
+#endif
+
+/********** Pnmread_new ********
+ *
+ * Allocates a new Pnmread_T for a pnm file and reads its header.
+ *
+ * Parameters:
+ *      FILE *fp: the open file, positioned at the start of the header
+ *
+ * Return: the new Pnmread_T, ready to read the first row
+ *
+ * Expects
+ *      fp is not NULL
+ *      the file holds a well-formed P1, P2, P4, or P5 header
+ *      the memory can be allocated
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. A regular file
+ *      is mapped copy-on-write, so that neither the file nor fp are touched,
+ *      and the pages already read are unmapped as rows are read; anything
+ *      else is read from fp in blocks. The caller still closes fp,
+ *      and may do so before the reader is freed if the file was mapped. The
+ *      memory is freed with Pnmread_free.
+ ************************/
+Pnmread_T Pnmread_new(FILE *fp) {
+        assert(fp != NULL);
+        Pnmread_T R = malloc(sizeof(*R));
+        assert(R != NULL);
+        R->fp = fp;
+        R->map = NULL;
+        R->map_length = 0;
+        R->unmapped = 0;
+        R->buffer = NULL;
+        R->capacity = 0;
+        R->at_eof = 0;
+
+        for (int byte = 0; byte < 256; byte++) {
+                unsigned char r = 0;
+                for (int bit = 0; bit < 8; bit++) {
+                        r |= ((byte >> bit) & 1) << (7 - bit);
+                }
+                reversed[byte] = r;
+        }
+
+        struct stat st;
+        off_t start = ftello(fp);
+        if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) &&
+            start >= 0 && st.st_size > start) {
+                R->map_length = st.st_size;
+                R->map = mmap(NULL, R->map_length, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE, fileno(fp), 0);
+                assert(R->map != MAP_FAILED);
+                R->next = R->map + start;
+                R->end = R->map + R->map_length;
+                R->at_eof = 1;
+        } else {
+                R->capacity = BLOCK_SIZE;
+                R->buffer = malloc(R->capacity);
+                assert(R->buffer != NULL);
+                R->next = R->buffer;
+                R->end = R->buffer;
+        }
+
+        read_header(R);
+        R->pixels_left = (size_t)R->data.width * R->data.height;
+        return R;
+}
+
+/********** Pnmread_data ********
+ *
+ * Returns the header of the pnm: its type, width, height, and denominator.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: the header, as for Pnmrdr_data
+ *
+ * Expects
+ *      R is not NULL
+ ************************/
+Pnmread_mapdata Pnmread_data(Pnmread_T R) {
+        assert(R != NULL);
+        return R->data;
+}
+
+/********** Pnmread_bits ********
+ *
+ * Reads the next row of a bitmap into a row of a Bit2.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      Bit2_T B2: the Bit2 to fill
+ *      int row: the row of B2 to fill
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      R and B2 are not NULL
+ *      the pnm is a bitmap, as wide as B2, with a row left to read
+ *      row is a row of B2
+ *      the row is well formed: for a plain bitmap, every pixel is 0 or 1
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. Black (1)
+ *      pixels are stored as 1 bits, as with Pnmrdr_get.
+ ************************/
+void Pnmread_bits(Pnmread_T R, Bit2_T B2, int row) {
+        assert(R != NULL && B2 != NULL);
+        assert(R->data.type == Pnmread_bit);
+        assert((unsigned)Bit2_width(B2) == R->data.width);
+        assert(row >= 0 && row < Bit2_height(B2));
+        assert(R->pixels_left >= R->data.width);
+        if (R->raw) {
+                raw_bits(R, B2, row);
+        } else {
+                plain_bits(R, B2, row);
+        }
+        R->pixels_left -= R->data.width;
+        release_read(R);
+}
+
+/********** Pnmread_values ********
+ *
+ * Reads the next values of a graymap into an array.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      unsigned *values: where to store the values
+ *      int count: how many values to read
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      R and values are not NULL
+ *      the pnm is a graymap with at least count values left to read
+ *      every value is at most the denominator
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. Values need
+ *      not line up with rows, but reading a row at a time is fastest.
+ ************************/
+void Pnmread_values(Pnmread_T R, unsigned *values, int count) {
+        assert(R != NULL && values != NULL);
+        assert(R->data.type == Pnmread_gray);
+        assert(count >= 0 && R->pixels_left >= (size_t)count);
+        if (R->raw && R->data.denominator < 256) {
+                assert(available(R, count) >= (size_t)count);
+                for (int i = 0; i < count; i++) {
+                        values[i] = R->next[i];
+                }
+                R->next += count;
+        } else if (R->raw) {
+                size_t bytes = 2 * (size_t)count;
+                assert(available(R, bytes) >= bytes);
+                for (int i = 0; i < count; i++) {
+                        values[i] = (R->next[2 * i] << 8) |
+                                    R->next[2 * i + 1];
+                }
+                R->next += bytes;
+        } else {
+                plain_values(R, values, count);
+        }
+        for (int i = 0; i < count; i++) {
+                assert(values[i] <= R->data.denominator);
+        }
+        R->pixels_left -= count;
+        release_read(R);
+}
+
+/********** Pnmread_view ********
+ *
+ * Returns a Bit2 that is a view of the pixels of a raw bitmap, in place in
+ * the mapped file, so that no row needs to be read at all.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: a Bit2_T viewing every row of the image, or NULL if the pnm is
+ *         not a raw (P4) bitmap in a mapped file, or some rows were read
+ *
+ * Expects
+ *      R is not NULL
+ *      a raw bitmap holds every row of pixels
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. The map is
+ *      private, so changes to the Bit2 never reach the file. The Bit2 must
+ *      be freed before R, which owns the mapping; once it is returned,
+ *      there are no rows left to read.
+ ************************/
+Bit2_T Pnmread_view(Pnmread_T R) {
+        assert(R != NULL);
+        size_t width = R->data.width;
+        size_t height = R->data.height;
+        if (R->map == NULL || !R->raw || R->data.type != Pnmread_bit ||
+            R->pixels_left != width * height || width == 0) {
+                return NULL;
+        }
+
+        size_t stride = width / 8 + (width % 8 != 0);
+        assert(height <= (size_t)(R->end - R->next) / stride);
+        R->pixels_left = 0;
+        return Bit2_wrap_buffer(R->map + (R->next - R->map), width, height,
+                                stride, BIT2_MSB_FIRST);
+}
+
+/********** Pnmread_free ********
+ *
+ * Frees a Pnmread_T, unmapping its file if it was mapped.
+ *
+ * Parameters:
+ *      Pnmread_T *R: the address of a pointer to a Pnmread_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      R and *R are not NULL
+ * Notes:
+ *      Does not close the file; sets *R to NULL.
+ ************************/
+void Pnmread_free(Pnmread_T *R) {
+        assert(R != NULL && *R != NULL);
+        if ((*R)->map != NULL) {
+                munmap((*R)->map + (*R)->unmapped,
+                       (*R)->map_length - (*R)->unmapped);
+        }
+        free((*R)->buffer);
+        free(*R);
+        *R = NULL;
+}
+
+/********** read_header ********
+ *
+ * Reads the magic number, size, and (for a graymap) denominator of a pnm,
+ * and the single whitespace byte that ends the header.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the header is not that of a P1, P2, P4, or P5 file, or
+ *      the width or height does not fit in an int, or the denominator is
+ *      not between 1 and 65535.
+ ************************/
+static void read_header(Pnmread_T R) {
+        assert(available(R, 2) >= 2 && R->next[0] == 'P');
+        char kind = R->next[1];
+        R->next += 2;
+        assert(kind == '1' || kind == '2' || kind == '4' || kind == '5');
+        R->raw = (kind == '4' || kind == '5');
+        R->data.type = (kind == '1' || kind == '4') ? Pnmread_bit :
+                                                      Pnmread_gray;
+        R->data.width = read_number(R);
+        R->data.height = read_number(R);
+        assert(R->data.width <= INT_MAX && R->data.height <= INT_MAX);
+        if (R->data.type == Pnmread_bit) {
+                R->data.denominator = 1;
+        } else {
+                R->data.denominator = read_number(R);
+                assert(R->data.denominator >= 1);
+                assert(R->data.denominator <= 65535);
+        }
+        assert(available(R, 1) >= 1 && is_space(*R->next));
+        R->next++;
+}
+
+/********** read_number ********
+ *
+ * Reads one decimal number from a pnm header, skipping the whitespace and
+ * comments before it.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: the number
+ *
+ * Notes:
+ *      Will CRE if no number follows, or it does not fit in an unsigned.
+ ************************/
+static unsigned read_number(Pnmread_T R) {
+        skip_space(R);
+        assert(available(R, 1) >= 1 && *R->next >= '0' && *R->next <= '9');
+        unsigned n = 0;
+        while (available(R, 1) >= 1 && *R->next >= '0' && *R->next <= '9') {
+                unsigned digit = *R->next - '0';
+                assert(n <= (UINT_MAX - digit) / 10);
+                n = 10 * n + digit;
+                R->next++;
+        }
+        return n;
+}
+
+/********** available ********
+ *
+ * Makes at least n unread bytes available, if the input holds that many.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      size_t n: the number of bytes wanted
+ *
+ * Return: the number of unread bytes available, which is less than n only
+ *         at the end of the input
+ *
+ * Notes:
+ *      Will CRE if the buffer cannot be grown. Without a map, the unread
+ *      bytes are moved to the front of the buffer, which is grown if it is
+ *      smaller than n, and the rest is filled from the file.
+ ************************/
+static size_t available(Pnmread_T R, size_t n) {
+        size_t left = R->end - R->next;
+        if (left >= n || R->at_eof) {
+                return left;
+        }
+
+        memmove(R->buffer, R->next, left);
+        if (R->capacity < n) {
+                R->capacity = (2 * R->capacity > n) ? 2 * R->capacity : n;
+                R->buffer = realloc(R->buffer, R->capacity);
+                assert(R->buffer != NULL);
+        }
+        while (left < n && !R->at_eof) {
+                size_t got = fread(R->buffer + left, 1, R->capacity - left,
+                                   R->fp);
+                if (got == 0) {
+                        R->at_eof = 1;
+                }
+                left += got;
+        }
+        R->next = R->buffer;
+        R->end = R->buffer + left;
+        return left;
+}
+
+/********** release_read ********
+ *
+ * Unmaps the pages of a mapped file that have been read, once there are at
+ * least BLOCK_SIZE bytes of them.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Nothing is ever read from before next, so the whole pages before it
+ *      are not needed again. Without this, every page of a large file would
+ *      stay resident until R is freed, even for a caller such as
+ *      unblackedges --stream that only keeps a few rows of its own.
+ ************************/
+static void release_read(Pnmread_T R) {
+        if (R->map == NULL ||
+            (size_t)(R->next - R->map) - R->unmapped < BLOCK_SIZE) {
+                return;
+        }
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t read = (size_t)(R->next - R->map);
+        size_t done = read - read % page;
+        int err = munmap(R->map + R->unmapped, done - R->unmapped);
+        assert(err == 0);
+        R->unmapped = done;
+}
+
+/********** skip_space ********
+ *
+ * Skips the whitespace and comments at the read position.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      A comment runs from a '#' to the end of its line.
+ ************************/
+static void skip_space(Pnmread_T R) {
+        while (available(R, 1) >= 1) {
+                if (*R->next == '#') {
+                        while (available(R, 1) >= 1 && *R->next != '\n') {
+                                R->next++;
+                        }
+                } else if (is_space(*R->next)) {
+                        R->next++;
+                } else {
+                        return;
+                }
+        }
+}
+
+/********** is_space ********
+ *
+ * Returns whether a byte is whitespace in a pnm: a space, tab, line feed,
+ * vertical tab, form feed, or carriage return.
+ ************************/
+static int is_space(int c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/********** raw_bits ********
+ *
+ * Reads the next row of a raw bitmap into a row of a Bit2, converting 8
+ * bytes at a time into one word.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      Bit2_T B2: the Bit2 to fill
+ *      int row: the row of B2 to fill
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the input ends before the row does. The padding bits at
+ *      the end of the row are dropped by Bit2_put_word.
+ ************************/
+static void raw_bits(Pnmread_T R, Bit2_T B2, int row) {
+        size_t stride = R->data.width / 8 + (R->data.width % 8 != 0);
+        assert(available(R, stride) >= stride);
+        for (int w = 0; w < Bit2_words_per_row(B2); w++) {
+                size_t first = 8 * (size_t)w;
+                size_t n = (stride - first < 8) ? stride - first : 8;
+                uint64_t word = 0;
+                for (size_t i = 0; i < n; i++) {
+                        word |= (uint64_t)reversed[R->next[first + i]] <<
+                                (8 * i);
+                }
+                Bit2_put_word(B2, w, row, word);
+        }
+        R->next += stride;
+}
+
+/********** plain_bits ********
+ *
+ * Reads the next row of a plain bitmap into a row of a Bit2.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      Bit2_T B2: the Bit2 to fill
+ *      int row: the row of B2 to fill
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the input ends before the row does, or holds anything but
+ *      0s, 1s, whitespace, and comments. Hands the row to plain_bits_avx2 if
+ *      the processor supports it, and otherwise takes 8 bytes at a time: if
+ *      each is a 0, a 1, or whitespace, the digits are picked out of the
+ *      word with masks, and otherwise a single pixel is read by plain_pixel.
+ *      A row may end in the middle of the 8 bytes, in which case the rest
+ *      are left for the next row.
+ ************************/
+static void plain_bits(Pnmread_T R, Bit2_T B2, int row) {
+#if defined(PNMREAD_X86)
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+                plain_bits_avx2(R, B2, row);
+                return;
+        }
+#endif
+        int width = R->data.width;
+        int col = 0;
+        uint64_t word = 0;
+        while (col < width) {
+                uint64_t chunk = 0;
+                uint64_t digits = 0;
+                uint64_t spaces = 0;
+                if (available(R, 8) >= 8) {
+                        chunk = load8(R->next);
+                        digits = zero_bytes((chunk ^ BYTES('0')) &
+                                            BYTES(0xFE));
+                        spaces = zero_bytes(chunk ^ BYTES(' ')) |
+                                 zero_bytes(chunk ^ BYTES('\n')) |
+                                 zero_bytes(chunk ^ BYTES('\r')) |
+                                 zero_bytes(chunk ^ BYTES('\t'));
+                }
+
+                if ((digits | spaces) != BYTES(0x80)) {
+                        /* a comment, the end of the input, or bad input */
+                        append_bits(B2, row, &word, &col, plain_pixel(R), 1);
+                        continue;
+                }
+
+                unsigned where = gather_bytes(digits);
+                unsigned ones = gather_bytes(digits & (chunk << 7));
+                int used = 8;
+                while (where != 0 && col < width) {
+                        int i = __builtin_ctz(where);
+                        append_bits(B2, row, &word, &col, (ones >> i) & 1, 1);
+                        where &= where - 1;
+                        used = i + 1;
+                }
+                if (where == 0) {
+                        used = 8;
+                }
+                R->next += used;
+        }
+        if (col % 64 != 0) {
+                Bit2_put_word(B2, col / 64, row, word);
+        }
+}
+
+/********** plain_pixel ********
+ *
+ * Reads the next pixel of a plain bitmap a byte at a time, skipping any
+ * whitespace and comments before it.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: the pixel, 0 or 1
+ *
+ * Notes:
+ *      Will CRE if the input ends, or the next pixel is not a 0 or a 1.
+ ************************/
+static int plain_pixel(Pnmread_T R) {
+        skip_space(R);
+        assert(available(R, 1) >= 1);
+        int c = *R->next++;
+        assert(c == '0' || c == '1');
+        return c - '0';
+}
+
+/********** append_bits ********
+ *
+ * Adds the next count pixels of a row of a Bit2 to the word being built,
+ * storing the word whenever it fills up.
+ *
+ * Parameters:
+ *      Bit2_T B2: the Bit2 being filled
+ *      int row: the row being filled
+ *      uint64_t *word: the word being built, holding the pixels of columns
+ *                      64 * (*col / 64) up to *col
+ *      int *col: the column of the next pixel, which is advanced by count
+ *      uint64_t bits: the pixels, the first in bit 0
+ *      int count: the number of pixels, at most 32
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      The caller stores the last, partial word of the row.
+ ************************/
+static void append_bits(Bit2_T B2, int row, uint64_t *word, int *col,
+                        uint64_t bits, int count) {
+        int shift = *col % 64;
+        *word |= bits << shift;
+        if (shift + count >= 64) {
+                Bit2_put_word(B2, *col / 64, row, *word);
+                *word = bits >> (64 - shift);
+        }
+        *col += count;
+}
+
+/********** plain_values ********
+ *
+ * Reads the next values of a plain graymap.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *      unsigned *values: where to store the values
+ *      int count: how many values to read
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the input ends first. Hands the values to
+ *      plain_values_avx2 if the processor supports it, and otherwise reads
+ *      them one at a time with plain_value.
+ ************************/
+static void plain_values(Pnmread_T R, unsigned *values, int count) {
+#if defined(PNMREAD_X86)
+        if (__builtin_cpu_supports("avx2")) {
+                plain_values_avx2(R, values, count);
+                return;
+        }
+#endif
+        for (int i = 0; i < count; i++) {
+                values[i] = plain_value(R);
+        }
+}
+
+/********** plain_value ********
+ *
+ * Reads the next value of a plain graymap.
+ *
+ * Parameters:
+ *      Pnmread_T R: a pointer to a Pnmread_T struct
+ *
+ * Return: the value
+ *
+ * Notes:
+ *      Will CRE if no value follows. A value of fewer than 8 digits with 8
+ *      bytes available is converted all at once by parse8; any other is
+ *      read a digit at a time.
+ ************************/
+static unsigned plain_value(Pnmread_T R) {
+        skip_space(R);
+        if (available(R, 8) >= 8) {
+                uint64_t chunk = load8(R->next);
+                uint64_t t = chunk ^ BYTES('0');
+                uint64_t others = (t | ((t & BYTES(0x7F)) + BYTES(0x76))) &
+                                  BYTES(0x80);
+                if (others != 0) {
+                        int digits = __builtin_ctzll(others) / 8;
+                        assert(digits > 0);
+                        R->next += digits;
+                        return parse8(chunk, digits);
+                }
+        }
+        return read_number(R);
+}
+
+/********** load8 ********
+ *
+ * Returns 8 bytes as a word, the first byte in the lowest 8 bits.
+ ************************/
+static uint64_t load8(const unsigned char *p) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        x = __builtin_bswap64(x);
+#endif
+        return x;
+}
+
+/********** zero_bytes ********
+ *
+ * Returns a word with the high bit set in each byte that is 0 in x, and
+ * every other bit clear.
+ *
+ * Notes:
+ *      Adding 0x7F to the low 7 bits of a byte sets its high bit unless
+ *      they are all 0, and no carry crosses into the next byte.
+ ************************/
+static uint64_t zero_bytes(uint64_t x) {
+        return ~(((x & BYTES(0x7F)) + BYTES(0x7F)) | x | BYTES(0x7F));
+}
+
+/********** gather_bytes ********
+ *
+ * Returns the high bits of the 8 bytes of x as an 8-bit number, the bit of
+ * byte i in bit i.
+ *
+ * Expects
+ *      only the high bit of each byte may be set
+ * Notes:
+ *      The multiply shifts each high bit to its own place in the top byte,
+ *      with no carries, since no two of the shifted bits land together.
+ ************************/
+static unsigned gather_bytes(uint64_t x) {
+        return (unsigned)(((x >> 7) * 0x0102040810204080u) >> 56);
+}
+
+/********** parse8 ********
+ *
+ * Converts the first digits bytes of chunk, which are decimal digits, into
+ * the number they spell.
+ *
+ * Expects
+ *      digits is between 1 and 7
+ * Notes:
+ *      The digits are shifted to the top of the word, leaving 0 bytes as
+ *      leading zeros, and then pairs of digits, pairs of pairs, and pairs of
+ *      those are combined, each step with one multiply.
+ ************************/
+static unsigned parse8(uint64_t chunk, int digits) {
+        uint64_t x = (chunk << (8 * (8 - digits))) & BYTES(0x0F);
+        x = (x * (1 + (10 << 8))) >> 8;
+        x = ((x & 0x00FF00FF00FF00FFu) * (1 + (100 << 16))) >> 16;
+        x = ((x & 0x0000FFFF0000FFFFu) * (1 + (10000ull << 32))) >> 32;
+        return (unsigned)x;
+}
+
+#if defined(PNMREAD_X86)
+/* the classes of byte found by classify_avx2 */
+#define DIGIT 1                 /* '0' to '9' */
+#define BLANK 2                 /* ' ' */
+#define CONTROL 4               /* '\t', '\n', '\v', '\f', or '\r' */
+
+/********** classify_avx2 ********
+ *
+ * Finds which of 32 bytes are digits and which are whitespace.
+ *
+ * Parameters:
+ *      const unsigned char *p: the 32 bytes
+ *      uint32_t *digits: where to store the digit mask, bit i for byte i
+ *      uint32_t *spaces: where to store the whitespace mask
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      only called when the processor supports AVX2. The classes a byte may
+ *      be in are looked up once for its low nibble and once for its high
+ *      nibble, each in a 16-entry table with a byte shuffle, and the byte is
+ *      in the classes both lookups allow: '#', for example, has the high
+ *      nibble of ' ' and the low nibble of '3', so it is in neither class.
+ *      Bytes of 0x80 and above have a high nibble past the table's classes.
+ ************************/
+__attribute__((target("avx2")))
+static void classify_avx2(const unsigned char *p, uint32_t *digits,
+                          uint32_t *spaces) {
+        const __m256i low_table = _mm256_setr_epi8(
+                DIGIT | BLANK, DIGIT, DIGIT, DIGIT, DIGIT, DIGIT, DIGIT,
+                DIGIT, DIGIT, DIGIT | CONTROL, CONTROL, CONTROL, CONTROL,
+                CONTROL, 0, 0,
+                DIGIT | BLANK, DIGIT, DIGIT, DIGIT, DIGIT, DIGIT, DIGIT,
+                DIGIT, DIGIT, DIGIT | CONTROL, CONTROL, CONTROL, CONTROL,
+                CONTROL, 0, 0);
+        const __m256i high_table = _mm256_setr_epi8(
+                CONTROL, 0, BLANK, DIGIT, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                CONTROL, 0, BLANK, DIGIT, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        const __m256i zero = _mm256_setzero_si256();
+
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i low = _mm256_and_si256(v, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(low_table,
+                                                               low),
+                                           _mm256_shuffle_epi8(high_table,
+                                                               high));
+        __m256i digit = _mm256_and_si256(classes, _mm256_set1_epi8(DIGIT));
+        __m256i space = _mm256_and_si256(classes,
+                                         _mm256_set1_epi8(BLANK | CONTROL));
+        *digits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(digit,
+                                                                    zero));
+        *spaces = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(space,
+                                                                    zero));
+}
+
+/********** plain_bits_avx2 ********
+ *
+ * Reads the next row of a plain bitmap into a row of a Bit2, 32 bytes at a
+ * time with AVX2.
+ *
+ * Parameters and expectations are as for plain_bits.
+ *
+ * Notes:
+ *      only called when the processor supports AVX2 and BMI2. If all 32
+ *      bytes are 0s, 1s, and whitespace, PEXT squeezes the low bit of each
+ *      digit out of the mask of digits, giving up to 32 pixels in order,
+ *      which are added to the row all at once; otherwise a single pixel is
+ *      read by plain_pixel. If the row ends among the 32 bytes, PDEP finds
+ *      the byte of its last pixel.
+ ************************/
+__attribute__((target("avx2,bmi2")))
+static void plain_bits_avx2(Pnmread_T R, Bit2_T B2, int row) {
+        const __m256i high_bits = _mm256_set1_epi8((char)0xfe);
+        const __m256i zero_char = _mm256_set1_epi8('0');
+        int width = R->data.width;
+        int col = 0;
+        uint64_t word = 0;
+        while (col < width) {
+                uint32_t digits = 0;
+                uint32_t spaces = 0;
+                uint32_t ones = 0;
+                if (available(R, 32) >= 32) {
+                        __m256i v = _mm256_loadu_si256((const __m256i *)
+                                                       R->next);
+                        uint32_t unused;
+                        classify_avx2(R->next, &unused, &spaces);
+                        digits = _mm256_movemask_epi8(
+                                _mm256_cmpeq_epi8(_mm256_and_si256(v,
+                                                                 high_bits),
+                                                  zero_char));
+                        ones = _mm256_movemask_epi8(_mm256_slli_epi16(v, 7));
+                }
+                if ((digits | spaces) != 0xffffffffu) {
+                        /* a comment, the end of the input, or bad input */
+                        append_bits(B2, row, &word, &col, plain_pixel(R), 1);
+                        continue;
+                }
+
+                int count = __builtin_popcount(digits);
+                int used = 32;
+                if (count > width - col) {
+                        count = width - col;
+                        digits = _pdep_u32((1u << count) - 1, digits);
+                        used = 32 - __builtin_clz(digits);
+                }
+                if (count > 0) {
+                        append_bits(B2, row, &word, &col,
+                                    _pext_u32(ones, digits), count);
+                }
+                R->next += used;
+        }
+        if (col % 64 != 0) {
+                Bit2_put_word(B2, col / 64, row, word);
+        }
+}
+
+/********** plain_values_avx2 ********
+ *
+ * Reads the next values of a plain graymap, up to four at a time with AVX2.
+ *
+ * Parameters and expectations are as for plain_values.
+ *
+ * Notes:
+ *      only called when the processor supports AVX2. The digit mask of the
+ *      next 32 bytes gives the first and last digit of each value; those
+ *      of up to 8 digits that end within the next 16 bytes, and before any
+ *      byte that is neither a digit nor whitespace, are converted together.
+ *      The 16 bytes are copied to both halves of a register and a shuffle
+ *      moves the digits of each value to the end of its own 8 bytes, with
+ *      0s in front. Multiply-adds then join pairs of digits (10a + b),
+ *      pairs of those (100a + b), and, after narrowing, pairs of those
+ *      (10000a + b). Anything else, such as a comment or a long value, is
+ *      left to plain_value.
+ ************************/
+__attribute__((target("avx2")))
+static void plain_values_avx2(Pnmread_T R, unsigned *values, int count) {
+        const __m256i tens = _mm256_set1_epi16(0x010a);
+        const __m256i hundreds = _mm256_set1_epi32(0x00010064);
+        const __m256i myriads = _mm256_set1_epi32(0x00012710);
+        int i = 0;
+        while (i < count) {
+                uint32_t digits = 0;
+                uint32_t spaces = 0;
+                if (available(R, 32) < 32) {
+                        values[i++] = plain_value(R);
+                        continue;
+                }
+                classify_avx2(R->next, &digits, &spaces);
+                uint32_t others = ~(digits | spaces);
+                int limit = (others == 0) ? 16 : __builtin_ctz(others);
+                if (limit > 16) {
+                        limit = 16;
+                }
+
+                uint32_t starts = digits & ~(digits << 1);
+                uint32_t ends = digits & ~(digits >> 1) &
+                                (((uint32_t)1 << limit) - 1);
+                uint64_t lanes[4];
+                int n = 0;
+                int end = 0;
+                while (n < 4 && i + n < count && ends != 0) {
+                        int first = __builtin_ctz(starts);
+                        int last = __builtin_ctz(ends);
+                        int length = last - first + 1;
+                        if (length > 8) {
+                                break;
+                        }
+                        /* bytes first.. of the 16 into the last length
+                           bytes of the lane; the rest of the lane is 0 */
+                        lanes[n] = (0x0706050403020100u + BYTES(first)) <<
+                                   (8 * (8 - length));
+                        if (length < 8) {
+                                lanes[n] |= BYTES(0x80) >> (8 * length);
+                        }
+                        starts &= starts - 1;
+                        ends &= ends - 1;
+                        end = last + 1;
+                        n++;
+                }
+                if (n == 0) {
+                        values[i++] = plain_value(R);
+                        continue;
+                }
+                for (int k = n; k < 4; k++) {
+                        lanes[k] = BYTES(0x80);
+                }
+
+                __m128i bytes = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)
+                                                             R->next),
+                                             _mm_set1_epi8('0'));
+                __m256i x = _mm256_shuffle_epi8(
+                        _mm256_broadcastsi128_si256(bytes),
+                        _mm256_setr_epi64x(lanes[0], lanes[1], lanes[2],
+                                           lanes[3]));
+                x = _mm256_maddubs_epi16(x, tens);
+                x = _mm256_madd_epi16(x, hundreds);
+                x = _mm256_packus_epi32(x, x);
+                x = _mm256_madd_epi16(x, myriads);
+                unsigned found[4];
+                found[0] = _mm256_extract_epi32(x, 0);
+                found[1] = _mm256_extract_epi32(x, 1);
+                found[2] = _mm256_extract_epi32(x, 4);
+                found[3] = _mm256_extract_epi32(x, 5);
+                for (int k = 0; k < n; k++) {
+                        values[i + k] = found[k];
+                }
+                i += n;
+                R->next += end;
+        }
+}
+#endif
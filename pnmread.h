@@ -0,0 +1,49 @@
+/*******************************************************************************
+ *
+ *                     pnmread.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file is the interface for Pnmread, our own reader for portable
+ *     bitmaps and graymaps in plain (P1, P2) and raw (P4, P5) form, in place of
+ *     the course's Pnmrdr. Rather than handing out one pixel per call, it fills
+ *     a whole row at a time: Pnmread_bits reads the next row of a bitmap
+ *     straight into a row of a Bit2, and Pnmread_values reads the next values
+ *     of a graymap into an array of unsigned, such as a row of a UArray2. A
+ *     regular file is mapped into memory, dropping the pages already read as it
+ *     goes, and any other input, such as a pipe, is read in large blocks;
+ *     either way, reading a row at a time takes bounded memory. For a mapped
+ *     raw bitmap, Pnmread_view returns a Bit2 that is a view of the pixels in
+ *     the file, with nothing read at all. Pnmread_data reports the header the
+ *     way Pnmrdr_data does. In this file, we typedef Pnmread_T to be a pointer
+ *     to a Pnmread_T struct, as defined in the implementation.
+ *
+ ******************************************************************************/
+#ifndef PNMREAD_INCLUDED
+#define PNMREAD_INCLUDED
+
+#include <stdio.h>
+#include "bit2.h"
+
+typedef struct Pnmread_T *Pnmread_T;
+
+/* the same values as Pnmrdr_bit and Pnmrdr_gray */
+typedef enum { Pnmread_bit = 1, Pnmread_gray = 2 } Pnmread_maptype;
+
+typedef struct Pnmread_mapdata {
+        Pnmread_maptype type;
+        unsigned width;
+        unsigned height;
+        unsigned denominator;   /* the maxval, or 1 for a bitmap */
+} Pnmread_mapdata;
+
+Pnmread_T Pnmread_new(FILE *fp);
+extern Pnmread_mapdata Pnmread_data(Pnmread_T R);
+extern void Pnmread_bits(Pnmread_T R, Bit2_T B2, int row);
+extern void Pnmread_values(Pnmread_T R, unsigned *values, int count);
+extern Bit2_T Pnmread_view(Pnmread_T R);
+extern void Pnmread_free(Pnmread_T *R);
+
+#endif
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ *
+ *                     snapshot.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of the snapshot format. Headers
+ *     are written as a Snapshot_header padded with zeros to
+ *     SNAPSHOT_HEADER_SIZE bytes. A mapped payload is obtained by mapping the
+ *     whole file (mmap offsets must be page aligned) and stepping past the
+ *     header; Snapshot_unmap steps back before unmapping.
+ *
+ ******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+
+#include "snapshot.h"
+#include "except.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/********** Snapshot_save ********
+ *
+ * Writes a snapshot file holding the given header and payload.
+ *
+ * Parameters:
+ *      const char *path:       name of the file to write
+ *      Snapshot_header header: the header; the version field is filled in
+ *      const void *payload:    header.payload bytes of payload
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      path is not NULL, and payload is not NULL unless header.payload is 0
+ *      the file can be created and written
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. Overwrites any
+ *      existing file.
+ ************************/
+void Snapshot_save(const char *path, Snapshot_header header,
+                   const void *payload)
+{
+        assert(path != NULL);
+        assert(payload != NULL || header.payload == 0);
+
+        unsigned char block[SNAPSHOT_HEADER_SIZE] = {0};
+        header.version = SNAPSHOT_VERSION;
+        memcpy(block, &header, sizeof(header));
+
+        FILE *fp = fopen(path, "wb");
+        assert(fp != NULL);
+        size_t n = fwrite(block, 1, sizeof(block), fp);
+        assert(n == sizeof(block));
+        if (header.payload > 0) {
+                n = fwrite(payload, 1, header.payload, fp);
+                assert(n == header.payload);
+        }
+        int err = fclose(fp);
+        assert(err == 0);
+}
+
+/********** Snapshot_probe ********
+ *
+ * Checks whether a file is a snapshot with the given magic.
+ *
+ * Parameters:
+ *      const char *path:       name of the file to check
+ *      const char magic[8]:    the magic expected at the start of the file
+ *
+ * Return: 1 if the file can be opened and starts with the magic, 0 otherwise.
+ *
+ * Expects
+ *      path is not NULL
+ * Notes:
+ *      Never CREs on a missing or unreadable file, so callers can use it to
+ *      decide between loading a snapshot and parsing an image.
+ ************************/
+int Snapshot_probe(const char *path, const char magic[8])
+{
+        assert(path != NULL);
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+                return 0;
+        }
+        char found[8];
+        int ok = fread(found, 1, sizeof(found), fp) == sizeof(found) &&
+                 memcmp(found, magic, sizeof(found)) == 0;
+        fclose(fp);
+        return ok;
+}
+
+/********** Snapshot_read_header ********
+ *
+ * Reads and validates the header of a snapshot file.
+ *
+ * Parameters:
+ *      const char *path:       name of the snapshot file
+ *      const char magic[8]:    the magic expected at the start of the file
+ *
+ * Return: The header of the snapshot.
+ *
+ * Expects
+ *      the file can be opened and starts with a header carrying the given
+ *      magic and SNAPSHOT_VERSION
+ *      the file holds exactly header.payload bytes after the header
+ * Notes:
+ *      Will CRE if any of the above expectations are not met.
+ ************************/
+Snapshot_header Snapshot_read_header(const char *path, const char magic[8])
+{
+        assert(path != NULL);
+        FILE *fp = fopen(path, "rb");
+        assert(fp != NULL);
+
+        unsigned char block[SNAPSHOT_HEADER_SIZE];
+        size_t n = fread(block, 1, sizeof(block), fp);
+        assert(n == sizeof(block));
+        Snapshot_header header;
+        memcpy(&header, block, sizeof(header));
+        assert(memcmp(header.magic, magic, sizeof(header.magic)) == 0);
+        assert(header.version == SNAPSHOT_VERSION);
+
+        struct stat st;
+        int err = fstat(fileno(fp), &st);
+        assert(err == 0);
+        assert((uint64_t)st.st_size == SNAPSHOT_HEADER_SIZE + header.payload);
+        fclose(fp);
+        return header;
+}
+
+/********** Snapshot_read_payload ********
+ *
+ * Copies the payload of a snapshot file into memory.
+ *
+ * Parameters:
+ *      const char *path:       name of the snapshot file
+ *      void *payload:          where to put the payload
+ *      size_t bytes:           the size of the payload
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      the header has already been validated with Snapshot_read_header
+ *      payload has room for bytes bytes
+ * Notes:
+ *      Will CRE if the file cannot be read.
+ ************************/
+void Snapshot_read_payload(const char *path, void *payload, size_t bytes)
+{
+        assert(path != NULL);
+        FILE *fp = fopen(path, "rb");
+        assert(fp != NULL);
+        int err = fseek(fp, SNAPSHOT_HEADER_SIZE, SEEK_SET);
+        assert(err == 0);
+        size_t n = fread(payload, 1, bytes, fp);
+        assert(n == bytes);
+        fclose(fp);
+}
+
+/********** Snapshot_map ********
+ *
+ * Maps the payload of a snapshot file into memory in place.
+ *
+ * Parameters:
+ *      const char *path:       name of the snapshot file
+ *      size_t bytes:           the size of the payload
+ *      int shared:             1 to write changes back to the file, 0 for a
+ *                              private copy-on-write mapping
+ *
+ * Return: A pointer to the first byte of the payload, or NULL if bytes is 0.
+ *
+ * Expects
+ *      the header has already been validated with Snapshot_read_header
+ *      the file can be opened and mapped
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. The payload is
+ *      aligned to SNAPSHOT_HEADER_SIZE bytes. Release it with Snapshot_unmap.
+ ************************/
+void *Snapshot_map(const char *path, size_t bytes, int shared)
+{
+        assert(path != NULL);
+        if (bytes == 0) {
+                return NULL;
+        }
+
+        int fd = open(path, shared ? O_RDWR : O_RDONLY);
+        assert(fd >= 0);
+        void *p = mmap(NULL, SNAPSHOT_HEADER_SIZE + bytes,
+                       PROT_READ | PROT_WRITE,
+                       shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        assert(p != MAP_FAILED);
+        close(fd);
+        return (char *)p + SNAPSHOT_HEADER_SIZE;
+}
+
+/********** Snapshot_unmap ********
+ *
+ * Releases a payload mapped with Snapshot_map.
+ *
+ * Parameters:
+ *      void *payload:          the pointer returned by Snapshot_map
+ *      size_t bytes:           the size of the payload
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      payload and bytes are as passed to and returned by Snapshot_map
+ * Notes:
+ *      Does nothing for a NULL payload. A shared mapping is written back
+ *      before it is unmapped.
+ ************************/
+void Snapshot_unmap(void *payload, size_t bytes)
+{
+        if (payload == NULL) {
+                return;
+        }
+        char *p = (char *)payload - SNAPSHOT_HEADER_SIZE;
+        msync(p, SNAPSHOT_HEADER_SIZE + bytes, MS_SYNC);
+        munmap(p, SNAPSHOT_HEADER_SIZE + bytes);
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ *
+ *                     snapshot.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides the interface for the binary snapshot format shared
+ *     by UArray2_save/UArray2_load and Bit2_save/Bit2_load. A snapshot is a
+ *     fixed SNAPSHOT_HEADER_SIZE-byte header followed by the raw payload of
+ *     the structure, exactly as it sits in memory. Because the header size is
+ *     a multiple of 64, a payload mapped in place with Snapshot_map is as
+ *     well aligned as one allocated on the heap, so a snapshot can be reloaded
+ *     without parsing or copying anything but the header. Snapshots are
+ *     written in the byte order of the machine that wrote them; the version
+ *     field lets a reader reject anything it does not understand. The file
+ *     mode taken by the mapped loaders of both structures is defined here,
+ *     so that neither interface has to include the other.
+ *
+ ******************************************************************************/
+#ifndef SNAPSHOT_INCLUDED
+#define SNAPSHOT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_HEADER_SIZE 64
+#define SNAPSHOT_VERSION 1
+
+/* how a file is mapped by UArray2_map_file, UArray2_load_mapped, and 
+   Bit2_load_mapped: created, opened with changes written back, or opened 
+   with private copy-on-write changes; the snapshot loaders take only the 
+   last two */
+typedef enum { 
+        UARRAY2_FILE_CREATE, UARRAY2_FILE_OPEN, UARRAY2_FILE_PRIVATE 
+} UArray2_filemode;
+
+typedef struct Snapshot_header {
+        char magic[8];          /* identifies the structure stored */
+        uint32_t version;       /* SNAPSHOT_VERSION */
+        uint32_t layout;        /* structure-specific storage layout */
+        uint64_t width;
+        uint64_t height;
+        uint64_t size;          /* bytes per element, or 0 for bits */
+        uint64_t payload;       /* bytes of payload after the header */
+} Snapshot_header;
+
+extern void Snapshot_save(const char *path, Snapshot_header header,
+                          const void *payload);
+extern int Snapshot_probe(const char *path, const char magic[8]);
+extern Snapshot_header Snapshot_read_header(const char *path,
+                                            const char magic[8]);
+extern void Snapshot_read_payload(const char *path, void *payload,
+                                  size_t bytes);
+extern void *Snapshot_map(const char *path, size_t bytes, int shared);
+extern void Snapshot_unmap(void *payload, size_t bytes);
+
+#endif
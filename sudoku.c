@@ -11,17 +11,25 @@
  *     solution. The program utilizes our 2 dimensional UArray structure
  *     UArray2 to represent the file. 
  *
+ *     Usage: sudoku [--snapshot=PATH] [file]
+ *     With --snapshot, the parsed sudoku is also saved to PATH as a UArray2
+ *     snapshot. A snapshot may be given in place of a pgm, in which case it 
+ *     is mapped in place rather than parsed.
+ *
  ******************************************************************************/
 #include "uarray2.h"
 #include "except.h"
 #include "assert.h"
-#include "pnmrdr.h"
+#include "pnmread.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 static FILE *open_or_abort(char *fname, char *mode);
-void check_pgm_header(Pnmrdr_T *reader);
-void populate_UArray2(UArray2_T U2, Pnmrdr_T *reader);
+void check_pgm_header(Pnmread_T *reader);
+void check_sudoku_snapshot(UArray2_T U2);
+void populate_UArray2(UArray2_T U2, Pnmread_T *reader);
+void populate_row(int row, void *elems, int count, void *cl);
 int colcheck_sudoku(UArray2_T U2);
 int rowcheck_sudoku(UArray2_T U2);
 int check_submap_sudoku(UArray2_T U2);
@@ -29,19 +37,39 @@ int submap_helper(UArray2_T U2, int start_col, int start_row);
 
 int main(int argc, char *argv[]) 
 {
+        /* optional --snapshot=PATH saves the parsed sudoku for fast reloads */
+        char *snapshot = NULL;
+        if (argc > 1 && strncmp(argv[1], "--snapshot=", 11) == 0) {
+                snapshot = argv[1] + 11;
+                argv++;
+                argc--;
+        }
         assert(argc <= 2);
-        FILE *fp;
-        if (argc == 1) {
-                fp = stdin;
+
+        UArray2_T sudoku;
+        if (argc == 2 && UArray2_is_snapshot(argv[1])) {
+                /* a saved sudoku is mapped in place, with no parsing */
+                sudoku = UArray2_load_mapped(argv[1], UARRAY2_FILE_PRIVATE);
+                check_sudoku_snapshot(sudoku);
         } else {
-                fp = open_or_abort(argv[1], "r");
-        }
+                FILE *fp;
+                if (argc == 1) {
+                        fp = stdin;
+                } else {
+                        fp = open_or_abort(argv[1], "r");
+                }
 
-        /* use pnmrdr to read in pgm file and import it to 2D array */
-        Pnmrdr_T reader = Pnmrdr_new(fp);
-        UArray2_T sudoku = UArray2_new(9, 9, 4);
-        check_pgm_header(&reader);
-        populate_UArray2(sudoku, &reader);
+                /* use pnmread to read in pgm file and import it to 2D array */
+                Pnmread_T reader = Pnmread_new(fp);
+                sudoku = UArray2_new(9, 9, 4);
+                check_pgm_header(&reader);
+                populate_UArray2(sudoku, &reader);
+                Pnmread_free(&reader);
+                fclose(fp);
+        }
+        if (snapshot != NULL) {
+                UArray2_save(sudoku, snapshot);
+        }
 
         /* each function called returns EXIT_FAILURE (1) in the case of bad 
            sudoku input or EXIT_SUCCESS (0) in the case of good sudoku input.
@@ -51,9 +79,7 @@ int main(int argc, char *argv[])
                      check_submap_sudoku(sudoku);
 
         /* free and clean!!! */
-        Pnmrdr_free(&reader);
         UArray2_free(&sudoku);
-        fclose(fp);
 
         if (result > 0) {
                 return EXIT_FAILURE;
@@ -91,20 +117,20 @@ static FILE *open_or_abort(char *fname, char *mode)
  * the sudoku program.
  *
  * Parameters:
- *      Pnmrdr_T *reader: address of the Pnmrdr object
+ *      Pnmread_T *reader: address of the Pnmread object
  *
  * Return: Doesn't return anything.
  *
  * Expects
- *      the type is either P2 or P5 (both fall under pnmrdr_mapdata.type == 2)
+ *      the type is either P2 or P5 (both fall under Pnmread_gray)
  *      the width and height == 9
  *      the denominator == 9
  * Notes:
  *      Will CRE if any of the above expectations are not met
  ************************/
-void check_pgm_header(Pnmrdr_T *reader) 
+void check_pgm_header(Pnmread_T *reader) 
 {
-        Pnmrdr_mapdata header_data = Pnmrdr_data(*reader);
+        Pnmread_mapdata header_data = Pnmread_data(*reader);
         
         assert(header_data.type == 2);
         assert(header_data.width == 9);
@@ -112,31 +138,76 @@ void check_pgm_header(Pnmrdr_T *reader)
         assert(header_data.denominator == 9);
 }
 
+/********** check_sudoku_snapshot ********
+ *
+ * Checks that a UArray2 loaded from a snapshot has the shape that the sudoku
+ * checks expect.
+ *
+ * Parameters:
+ *      UArray2_T U2: a pointer to a UArray2_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      the width and height == 9
+ *      the elements are unsigned and stored row-major
+ * Notes:
+ *      Will CRE if any of the above expectations are not met. The values 
+ *      themselves are checked by the sudoku checks, as for a pgm.
+ ************************/
+void check_sudoku_snapshot(UArray2_T U2) 
+{
+        assert(UArray2_width(U2) == 9);
+        assert(UArray2_height(U2) == 9);
+        assert(UArray2_size(U2) == sizeof(unsigned));
+        assert(UArray2_get_layout(U2) == UARRAY2_ROW_MAJOR);
+}
+
 /********** populate_UArray2 ********
  *
  * Populates the UArray2_T struct using the values read from the pnm by the
- * pnmrdr object.
+ * pnmread object.
  *
  * Parameters:
  *      UArray2_T U2: a pointer to a UArray2_T struct
- *      Pnmrdr_T *reader: address of the Pnmrdr object
+ *      Pnmread_T *reader: address of the Pnmread object
  *
  * Return: Doesn't return anything.
  *
  * Expects
- *      UArray2_T and Pnmrdr_T are not NULL, as checked in previous functions
+ *      UArray2_T and Pnmread_T are not NULL, as checked in previous functions
  * Notes:
- *      No additional notes.
+ *      Fills the array one row at a time through populate_row.
  ************************/
-void populate_UArray2(UArray2_T U2, Pnmrdr_T *reader) 
+void populate_UArray2(UArray2_T U2, Pnmread_T *reader) 
 {
-        for (int row = 0; row < UArray2_height(U2); row++) {
-                for (int col = 0; col < UArray2_width(U2); col++) {
-                        unsigned temp = Pnmrdr_get(*reader);
-                        unsigned *n = UArray2_at(U2, col, row);
-                        *n = temp;
-                }
-        }
+        assert(UArray2_size(U2) == sizeof(unsigned));
+        UArray2_map_rows_span(U2, populate_row, reader);
+}
+
+/********** populate_row ********
+ *
+ * Reads one row of pixels from the pnmread object into a row of the UArray2.
+ *
+ * Parameters:
+ *      int row: index of the row being filled (unused)
+ *      void *elems: the contiguous unsigned elements of the row
+ *      int count: the number of elements in the row
+ *      void *cl: address of the Pnmread object
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      elems holds count unsigned values, as checked in populate_UArray2
+ * Notes:
+ *      Called by UArray2_map_rows_span for each row, top to bottom. The 
+ *      whole row is read with one call to Pnmread_values.
+ ************************/
+void populate_row(int row, void *elems, int count, void *cl) 
+{
+        (void)row;
+        Pnmread_T *reader = cl;
+        Pnmread_values(*reader, elems, count);
 }
 
 /********** colcheck_sudoku ********
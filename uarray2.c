@@ -6,27 +6,126 @@
  *     Authors:    Simon Rands (srands01) and Ian Ryan (iryan01)
  *     Date:       9/28/23
  *
- *     This file contains the implementation of the UArray2 data structure. The 
- *     UArray2 relies on Hanson's UArray data structure. It represents a 
- *     2-dimensional array by using a single 1-demnsional UArray where the 
- *     first WIDTH elements in the 1D array represent the first column in the 
- *     2D array, etc.
+ *     This file contains the implementation of the UArray2 data structure. It
+ *     represents a 2-dimensional array by using a single 1-dimensional block
+ *     of memory where the first WIDTH elements represent the first row in the
+ *     2D array, etc. The unchecked accessors in uarray2.h index this block
+ *     directly.
+ *
+ *     Dimensions and indices are kept in size_t, and the size of the block is
+ *     computed with overflow checks, so that arrays with more than INT_MAX 
+ *     elements (such as 40K x 40K scans) can be created with UArray2_new64 
+ *     and reached with UArray2_at64. Hanson's UArray takes an int length, so
+ *     we allocate the block ourselves rather than wrapping a UArray.
+ *
+ *     The block either comes from the heap or, for arrays created with 
+ *     UArray2_map_file, is an mmap of a file holding the raw elements in 
+ *     row-major order, or, for arrays loaded with UArray2_load_mapped, is the
+ *     payload of a snapshot file mapped in place, or, for arrays created with
+ *     UArray2_new_in, is carved from an arena together with the handle. 
+ *     Everything except allocation and freeing treats them all the same way.
+ *
+ *     An array created with the UARRAY2_MORTON layout instead splits the grid
+ *     into square tiles of TILE x TILE cells (TILE the smallest power of two
+ *     that covers the shorter side of the array, at most MORTON_TILE_MAX),
+ *     stores the tiles in row-major order, and stores the cells of each tile
+ *     in Morton (Z) order: the index of a cell within its tile interleaves the
+ *     bits of its column (even bits) and row (odd bits). Neighbours in either
+ *     direction are then usually close in memory, so row-major and
+ *     column-major passes touch cache lines equally well. Tiles on the right
+ *     and bottom edges are stored whole; the cells that lie outside the array
+ *     are never visited. As a tile is less than twice the shorter side, each
+ *     side is padded by less than a factor of two, so the padding is under 4x
+ *     even for a long, thin array.
  *
  ******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+
 #include "uarray2.h"
-#include "uarray.h"
+#include "snapshot.h"
 #include "except.h"
 #include "assert.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#define MORTON_TILE_MAX 256
+
+static const char SNAPSHOT_MAGIC[8] = {
+        'U', 'A', 'R', 'R', 'A', 'Y', '2', 'S'
+};
 
 struct UArray2_T {
-        int width;
-        int height;
-        int size;
-        UArray_T U_internal;
+        size_t width;
+        size_t height;
+        size_t size;
+        size_t length;          /* elements in the block, including padding */
+        char *base;
+        UArray2_layout layout;
+        int tile_shift;         /* log2 of the side of a Morton tile */
+        size_t tiles_wide;      /* Morton tiles per row of tiles */
+        enum {
+                STORAGE_HEAP, STORAGE_FILE, STORAGE_SNAPSHOT, STORAGE_ARENA
+        } storage;
+        int shared;             /* file changes are written back */
 };
 
+/* one horizontal band of rows, traversed by a single worker thread */
+struct band {
+        UArray2_T U2;
+        void (*apply)(int col, int row, UArray2_T U2, void *p1, void *p2);
+        void *cl;
+        int first_row;
+        int end_row;
+};
+
+/* the worker threads behind UArray2_map_row_major_parallel, started the
+   first time they are needed and kept for later calls; lock guards every
+   field but call, which is held for a whole call so that only one is using
+   the workers at a time */
+static struct {
+        pthread_mutex_t call;
+        pthread_mutex_t lock;
+        pthread_cond_t work;            /* a band is waiting, or stopping */
+        pthread_cond_t done;            /* pending has reached zero */
+        pthread_t *threads;
+        int nworkers;
+        struct band *bands;             /* the bands of the current call */
+        int nbands;
+        int next_band;                  /* the next band to hand out */
+        int pending;                    /* handed-out bands not yet done */
+        int stopping;
+} pool = {
+        PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+        PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+        NULL, 0, NULL, 0, 0, 0, 0
+};
+
+static UArray2_T new_array(size_t width, size_t height, size_t size,
+                           UArray2_layout layout);
+static UArray2_T new_handle(size_t width, size_t height, size_t size,
+                            UArray2_layout layout);
+static void set_shape(UArray2_T U2, size_t width, size_t height, size_t size,
+                      UArray2_layout layout);
+static size_t mul_checked(size_t a, size_t b);
+static void assert_int_dims(UArray2_T U2);
+static void grow_pool(int nworkers);
+static void *pool_worker(void *arg);
+static void stop_pool(void);
+static void map_band(struct band *b);
+static inline uint32_t spread_bits(uint32_t x);
+static inline uint32_t compact_bits(uint32_t x);
+static inline size_t index_of(UArray2_T U2, size_t col, size_t row);
+
 /********** UArray2_new ********
  *
  * Allocates, initializes, and returns a new UArray2_T.
@@ -46,24 +145,350 @@ struct UArray2_T {
  *
  * Notes:
  *      Will CRE if the above expectations are not met. Malloc's memory that 
- *              will be free'd by UArray2_free. 
+ *              will be free'd by UArray2_free. Uses the UARRAY2_ROW_MAJOR
+ *              layout.
  ************************/
 UArray2_T UArray2_new(int width, int height, int size) {
+        return UArray2_new_layout(width, height, size, UARRAY2_ROW_MAJOR);
+}
+
+/********** UArray2_new_layout ********
+ *
+ * Allocates, initializes, and returns a new UArray2_T that stores its 
+ * elements in the given layout.
+ *
+ * Parameters:
+ *      width:          integer holding the width of the 2d array
+ *      height:         integer holding the height of the 2d array
+ *      size:           integer holding the size, in bytes, of each element
+ *      layout:         UARRAY2_ROW_MAJOR or UARRAY2_MORTON
+ *
+ * Return: A UArray2_T, which is a pointer to the UArray2_T defined at the top 
+ *         of this file.
+ *
+ * Expects
+ *      Width is non-negative.
+ *      Height is non-negative.
+ *      Size is positive.
+ *      Layout is one of the two layouts above.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Malloc's memory that 
+ *              will be free'd by UArray2_free. A Morton array uses the 
+ *              smallest power-of-two tile side that covers its shorter side,
+ *              capped at MORTON_TILE_MAX, so it holds fewer than 4 times as
+ *              many cells as a row-major array of the same size.
+ ************************/
+UArray2_T UArray2_new_layout(int width, int height, int size, 
+                             UArray2_layout layout) {
         assert(width >= 0);
         assert(height >= 0);
         assert(size > 0);
+        return new_array(width, height, size, layout);
+}
+
+/********** UArray2_new64 ********
+ *
+ * Allocates, initializes, and returns a new UArray2_T whose element count may
+ * exceed INT_MAX.
+ *
+ * Parameters:
+ *      width:          the width of the 2d array
+ *      height:         the height of the 2d array
+ *      size:           the size, in bytes, of each element
+ *
+ * Return: A UArray2_T, which is a pointer to the UArray2_T defined at the top 
+ *         of this file.
+ *
+ * Expects
+ *      Size is positive.
+ *      width * height * size does not overflow a size_t.
+ *      The memory can be allocated.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Uses the 
+ *              UARRAY2_ROW_MAJOR layout. The int interface (UArray2_width, 
+ *              UArray2_at, the maps, ...) may still be used as long as the
+ *              width and height each fit in an int.
+ ************************/
+UArray2_T UArray2_new64(size_t width, size_t height, size_t size) {
+        assert(size > 0);
+        return new_array(width, height, size, UARRAY2_ROW_MAJOR);
+}
 
-        UArray_T U = UArray_new((width * height), size);
-        UArray2_T U2 = malloc(24);
+/********** UArray2_new_in ********
+ *
+ * Allocates, initializes, and returns a new UArray2_T whose handle and 
+ * elements both come from an arena.
+ *
+ * Parameters:
+ *      arena:          the arena to allocate from
+ *      width:          integer holding the width of the 2d array
+ *      height:         integer holding the height of the 2d array
+ *      size:           integer holding the size, in bytes, of each element
+ *
+ * Return: A UArray2_T, which is a pointer to the UArray2_T defined at the top 
+ *         of this file.
+ *
+ * Expects
+ *      arena is not NULL.
+ *      Width is non-negative.
+ *      Height is non-negative.
+ *      Size is positive.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Uses the 
+ *              UARRAY2_ROW_MAJOR layout. The handle and the elements are one
+ *              allocation from the arena, so creating the array never calls
+ *              malloc once the arena is large enough. The array lives until
+ *              the arena is reset or freed; UArray2_free releases nothing.
+ ************************/
+UArray2_T UArray2_new_in(UArray2_Arena_T arena, int width, int height, 
+                         int size) {
+        assert(arena != NULL);
+        assert(width >= 0);
+        assert(height >= 0);
+        assert(size > 0);
+
+        struct UArray2_T shape;
+        set_shape(&shape, width, height, size, UARRAY2_ROW_MAJOR);
+
+        /* the elements follow the handle, rounded up so that they are as 
+           well aligned as the handle itself */
+        size_t handle = (sizeof(shape) + 15) / 16 * 16;
+        size_t bytes = mul_checked(shape.length, size);
+        assert(bytes <= SIZE_MAX - handle);
+        char *block = UArray2_Arena_alloc(arena, handle + bytes);
+
+        UArray2_T U2 = (UArray2_T)block;
+        *U2 = shape;
+        U2->base = (bytes > 0) ? block + handle : NULL;
+        U2->storage = STORAGE_ARENA;
+        return U2;
+}
+
+/********** UArray2_map_file ********
+ *
+ * Creates a UArray2_T whose storage is a memory-mapped file rather than the
+ * heap.
+ *
+ * Parameters:
+ *      path:           name of the file holding the elements
+ *      width:          the width of the 2d array
+ *      height:         the height of the 2d array
+ *      size:           the size, in bytes, of each element
+ *      mode:           UARRAY2_FILE_CREATE to create (or truncate) the file
+ *                      and start with every element zeroed;
+ *                      UARRAY2_FILE_OPEN to reopen an existing file, with
+ *                      changes written back to it;
+ *                      UARRAY2_FILE_PRIVATE to reopen an existing file with
+ *                      copy-on-write, leaving the file untouched
+ *
+ * Return: A UArray2_T, which is a pointer to the UArray2_T defined at the top 
+ *         of this file.
+ *
+ * Expects
+ *      Size is positive, and width * height * size fits in a size_t.
+ *      The file can be opened (and, for UARRAY2_FILE_CREATE, resized).
+ *      For the other two modes, the file holds exactly width * height * size
+ *      bytes.
+ *      The file can be mapped.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. The file holds the raw
+ *              elements in row-major order and nothing else; the array uses 
+ *              the UARRAY2_ROW_MAJOR layout, so the raw accessors and all the
+ *              map functions work on it. UArray2_flush writes changes back
+ *              early; UArray2_free flushes and unmaps the file.
+ ************************/
+UArray2_T UArray2_map_file(const char *path, size_t width, size_t height, 
+                           size_t size, UArray2_filemode mode) {
+        assert(path != NULL);
+        assert(mode == UARRAY2_FILE_CREATE || mode == UARRAY2_FILE_OPEN ||
+               mode == UARRAY2_FILE_PRIVATE);
+
+        UArray2_T U2 = new_handle(width, height, size, UARRAY2_ROW_MAJOR);
+        size_t bytes = mul_checked(U2->length, size);
+        U2->storage = STORAGE_FILE;
+        U2->shared = (mode != UARRAY2_FILE_PRIVATE);
+
+        int flags = (mode == UARRAY2_FILE_CREATE) ? O_RDWR | O_CREAT | O_TRUNC
+                  : (mode == UARRAY2_FILE_OPEN)   ? O_RDWR
+                                                  : O_RDONLY;
+        int fd = open(path, flags, 0666);
+        assert(fd >= 0);
+
+        if (mode == UARRAY2_FILE_CREATE) {
+                assert((off_t)bytes >= 0);
+                int err = ftruncate(fd, (off_t)bytes);
+                assert(err == 0);
+        } else {
+                struct stat st;
+                int err = fstat(fd, &st);
+                assert(err == 0);
+                assert((size_t)st.st_size == bytes);
+        }
+
+        if (bytes > 0) {
+                void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+                               U2->shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+                assert(p != MAP_FAILED);
+                U2->base = p;
+        }
+        close(fd);
+        return U2;
+}
+
+/********** UArray2_flush ********
+ *
+ * Writes any changes to a file-backed array back to its file.
+ *
+ * Parameters:
+ *      U2: pointer to a UArray2_T struct
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met, or if the write back
+ *              fails. Does nothing for heap-backed arrays and for arrays 
+ *              opened with UARRAY2_FILE_PRIVATE. Blocks until the data is 
+ *              on disk.
+ ************************/
+void UArray2_flush(UArray2_T U2) {
         assert(U2 != NULL);
+        if (U2->storage == STORAGE_HEAP || !U2->shared || U2->base == NULL) {
+                return;
+        }
 
-        U2->width = width;
-        U2->height = height;
-        U2->size = size;
-        U2->U_internal = U;
+        /* msync needs a page-aligned start, which a snapshot payload is not;
+           syncing from the start of its page covers the header as well */
+        uintptr_t start = (uintptr_t)U2->base;
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t aligned = start - start % page;
+        int err = msync((void *)aligned, 
+                        start - aligned + U2->length * U2->size, MS_SYNC);
+        assert(err == 0);
+}
+
+/********** UArray2_save ********
+ *
+ * Writes the 2d array to a snapshot file that UArray2_load and 
+ * UArray2_load_mapped can reload without parsing.
+ *
+ * Parameters:
+ *      U2:   pointer to a UArray2_T struct
+ *      path: name of the file to write
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 and path are not NULL.
+ *      The file can be created and written.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. The snapshot records
+ *              the width, height, element size, and layout, followed by the
+ *              elements exactly as they are stored (including the padding of
+ *              a Morton array). Overwrites any existing file.
+ ************************/
+void UArray2_save(UArray2_T U2, const char *path) {
+        assert(U2 != NULL);
+        assert(path != NULL);
+
+        Snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.layout = U2->layout;
+        header.width = U2->width;
+        header.height = U2->height;
+        header.size = U2->size;
+        header.payload = U2->length * U2->size;
+        Snapshot_save(path, header, U2->base);
+}
+
+/********** UArray2_load ********
+ *
+ * Reads a snapshot file written by UArray2_save into a new heap-backed array.
+ *
+ * Parameters:
+ *      path: name of the snapshot file
+ *
+ * Return: A UArray2_T with the dimensions, element size, layout, and 
+ *         contents recorded in the snapshot.
+ *
+ * Expects
+ *      The file is a valid UArray2 snapshot.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. The array is 
+ *              independent of the file once loaded.
+ ************************/
+UArray2_T UArray2_load(const char *path) {
+        Snapshot_header header = Snapshot_read_header(path, SNAPSHOT_MAGIC);
+        UArray2_T U2 = new_array(header.width, header.height, header.size, 
+                                 header.layout);
+        assert(header.payload == U2->length * U2->size);
+        Snapshot_read_payload(path, U2->base, header.payload);
         return U2;
 }
 
+/********** UArray2_load_mapped ********
+ *
+ * Maps the payload of a snapshot file written by UArray2_save in place, so
+ * that loading costs only a header read.
+ *
+ * Parameters:
+ *      path: name of the snapshot file
+ *      mode: UARRAY2_FILE_OPEN to write changes back to the snapshot, or 
+ *            UARRAY2_FILE_PRIVATE for a copy-on-write view of it
+ *
+ * Return: A UArray2_T with the dimensions, element size, layout, and 
+ *         contents recorded in the snapshot.
+ *
+ * Expects
+ *      The file is a valid UArray2 snapshot.
+ *      Mode is UARRAY2_FILE_OPEN or UARRAY2_FILE_PRIVATE.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. UArray2_flush and 
+ *              UArray2_free behave as for UArray2_map_file.
+ ************************/
+UArray2_T UArray2_load_mapped(const char *path, UArray2_filemode mode) {
+        assert(mode == UARRAY2_FILE_OPEN || mode == UARRAY2_FILE_PRIVATE);
+
+        Snapshot_header header = Snapshot_read_header(path, SNAPSHOT_MAGIC);
+        UArray2_T U2 = new_handle(header.width, header.height, header.size,
+                                  header.layout);
+        assert(header.payload == mul_checked(U2->length, U2->size));
+        U2->storage = STORAGE_SNAPSHOT;
+        U2->shared = (mode == UARRAY2_FILE_OPEN);
+        U2->base = Snapshot_map(path, header.payload, U2->shared);
+        return U2;
+}
+
+/********** UArray2_is_snapshot ********
+ *
+ * Checks whether a file is a UArray2 snapshot.
+ *
+ * Parameters:
+ *      path: name of the file to check
+ *
+ * Return: 1 if the file starts with the UArray2 snapshot magic, 0 otherwise
+ *         (including when the file cannot be opened).
+ *
+ * Expects
+ *      path is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+int UArray2_is_snapshot(const char *path) {
+        return Snapshot_probe(path, SNAPSHOT_MAGIC);
+}
+
 /********** UArray2_width ********
  *
  * Gets the width of the 2d array.
@@ -75,13 +500,15 @@ UArray2_T UArray2_new(int width, int height, int size) {
  *
  * Expects
  *      U2 is not NULL.
+ *      The width fits in an int (use UArray2_width64 otherwise).
  *
  * Notes:
  *      Will CRE if the above expectations are not met.
  ************************/
 int UArray2_width(UArray2_T U2) {
         assert(U2 != NULL);
-        return U2->width;
+        assert(U2->width <= INT_MAX);
+        return (int)U2->width;
 }
 
 /********** UArray2_height ********
@@ -95,13 +522,15 @@ int UArray2_width(UArray2_T U2) {
  *
  * Expects
  *      U2 is not NULL
+ *      The height fits in an int (use UArray2_height64 otherwise).
  *
  * Notes:
  *      Will CRE if the above expectations are not met.
  ************************/
 int UArray2_height(UArray2_T U2) {
         assert(U2 != NULL);
-        return U2->height;
+        assert(U2->height <= INT_MAX);
+        return (int)U2->height;
 }
 
 /********** UArray2_size ********
@@ -121,7 +550,28 @@ int UArray2_height(UArray2_T U2) {
  ************************/
 int UArray2_size(UArray2_T U2) {
         assert(U2 != NULL);
-        return U2->size;
+        assert(U2->size <= INT_MAX);
+        return (int)U2->size;
+}
+
+/********** UArray2_get_layout ********
+ *
+ * Gets the layout the 2d array was created with.
+ *
+ * Parameters:
+ *     A UArray2_T, which is a pointer to a UArray2_T struct.
+ *
+ * Return: UARRAY2_ROW_MAJOR or UARRAY2_MORTON.
+ *
+ * Expects
+ *      U2 is not NULL
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. 
+ ************************/
+UArray2_layout UArray2_get_layout(UArray2_T U2) {
+        assert(U2 != NULL);
+        return U2->layout;
 }
 
 /********** UArray2_at ********
@@ -142,17 +592,86 @@ int UArray2_size(UArray2_T U2) {
  *
  * Notes:
  *      Will CRE if the above expectations are not met. Gets the index in the
- *              underlying 1d array using the formula (col * width) + row.
+ *              underlying 1d array using the formula (row * width) + col, or
+ *              the tiled Morton index for a UARRAY2_MORTON array.
  ************************/
 void *UArray2_at(UArray2_T U2, int col, int row) {
         assert(U2 != NULL);
         assert(col >= 0);
         assert(row >= 0);
+        assert((size_t)col < U2->width);
+        assert((size_t)row < U2->height);
+        
+        return U2->base + index_of(U2, col, row) * U2->size;
+}
+
+/********** UArray2_width64 ********
+ *
+ * Gets the width of the 2d array as a size_t.
+ *
+ * Parameters:
+ *      A UArray2_T, which is a pointer to a UArray2_T struct.
+ *
+ * Return: the width of the UArray2
+ *
+ * Expects
+ *      U2 is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+size_t UArray2_width64(UArray2_T U2) {
+        assert(U2 != NULL);
+        return U2->width;
+}
+
+/********** UArray2_height64 ********
+ *
+ * Gets the height of the 2d array as a size_t.
+ *
+ * Parameters:
+ *      A UArray2_T, which is a pointer to a UArray2_T struct.
+ *
+ * Return: the height of the UArray2
+ *
+ * Expects
+ *      U2 is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+size_t UArray2_height64(UArray2_T U2) {
+        assert(U2 != NULL);
+        return U2->height;
+}
+
+/********** UArray2_at64 ********
+ *
+ * Gets the element at the provided index in the 2d array, using size_t
+ * indices.
+ *
+ * Parameters:
+ *      U2:  pointer to a UArray2_T struct
+ *      col: the column of the element
+ *      row: the row of the element
+ *
+ * Return: A void pointer to the element at the provided index.
+ *
+ * Expects
+ *      U2 is not NULL.
+ *      col is less than the width of the 2d array.
+ *      row is less than the height of the 2d array.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. All index arithmetic
+ *              is done in size_t.
+ ************************/
+void *UArray2_at64(UArray2_T U2, size_t col, size_t row) {
+        assert(U2 != NULL);
         assert(col < U2->width);
         assert(row < U2->height);
-        
-        int index = ((col * U2->width) + row);
-        return UArray_at((U2->U_internal), index);
+
+        return U2->base + index_of(U2, col, row) * U2->size;
 }
 
 /********** UArray2_map_col_major ********
@@ -174,17 +693,40 @@ void *UArray2_at(UArray2_T U2, int col, int row) {
  * Notes:
  *      Will CRE if the above expectations are not met. May edit values in the
  *              2d array by reference, depending on the client's cl and apply.
+ *              The bounds are checked once up front; the traversal then walks
+ *              the underlying storage, stepping one row stride per element
+ *              (or computing the Morton index of each element).
  ************************/
 void UArray2_map_col_major(UArray2_T U2, 
                            void apply(int col, int row, UArray2_T U2, void *p1, 
                                       void *p2), 
                            void *cl) {
         assert(U2 != NULL);
-        for (int col_idx = 0; col_idx < UArray2_width(U2); col_idx++) {
-                for (int row_idx = 0; row_idx < UArray2_height(U2); row_idx++){
-                        apply(col_idx, row_idx, U2, UArray2_at(U2, col_idx, 
-                        row_idx), cl);
+        assert_int_dims(U2);
+        int width = (int)U2->width;
+        int height = (int)U2->height;
+        size_t size = U2->size;
+        size_t stride = (size_t)width * size;
+
+        if (U2->layout == UARRAY2_MORTON) {
+                for (int col_idx = 0; col_idx < width; col_idx++) {
+                        for (int row_idx = 0; row_idx < height; row_idx++) {
+                                apply(col_idx, row_idx, U2, U2->base + 
+                                      index_of(U2, col_idx, row_idx) * size,
+                                      cl);
+                        }
                 }
+                return;
+        }
+
+        char *col_start = U2->base;
+        for (int col_idx = 0; col_idx < width; col_idx++) {
+                char *elem = col_start;
+                for (int row_idx = 0; row_idx < height; row_idx++) {
+                        apply(col_idx, row_idx, U2, elem, cl);
+                        elem += stride;
+                }
+                col_start += size;
         }
 }
 
@@ -207,18 +749,365 @@ void UArray2_map_col_major(UArray2_T U2,
  * Notes:
  *      Will CRE if the above expectations are not met. May edit values in the 
  *              2d array by reference, depending on the client's cl and apply.
+ *              The bounds are checked once up front; the traversal then walks
+ *              the underlying storage sequentially (or computes the Morton 
+ *              index of each element).
  */
 void UArray2_map_row_major(UArray2_T U2, 
                            void apply(int col, int row, UArray2_T U2, void *p1, 
                                       void *p2), 
                            void *cl) {
         assert(U2 != NULL);
-        for (int row_idx = 0; row_idx < UArray2_height(U2); row_idx++) {
-                for (int col_idx = 0; col_idx < UArray2_width(U2); col_idx++){
-                        apply(col_idx, row_idx, U2, UArray2_at(U2, col_idx,
-                        row_idx), cl);
+        assert_int_dims(U2);
+        int width = (int)U2->width;
+        int height = (int)U2->height;
+        size_t size = U2->size;
+
+        if (U2->layout == UARRAY2_MORTON) {
+                for (int row_idx = 0; row_idx < height; row_idx++) {
+                        for (int col_idx = 0; col_idx < width; col_idx++) {
+                                apply(col_idx, row_idx, U2, U2->base + 
+                                      index_of(U2, col_idx, row_idx) * size,
+                                      cl);
+                        }
+                }
+                return;
+        }
+
+        char *elem = U2->base;
+        for (int row_idx = 0; row_idx < height; row_idx++) {
+                for (int col_idx = 0; col_idx < width; col_idx++) {
+                        apply(col_idx, row_idx, U2, elem, cl);
+                        elem += size;
+                }
+        }
+}
+
+/********** UArray2_map_row_major_parallel ********
+ *
+ * Traverses the 2d array with NTHREADS threads, splitting it into horizontal
+ * bands of consecutive rows and calling the apply function at each index.
+ * The threads come from a pool of workers that is kept between calls.
+ * 
+ * Parameters:
+ *      U2:       pointer to a UArray2_T struct
+ *      apply:    a function supplied by the client with the intention of 
+ *                calling it on each index
+ *      cl:       an array of NTHREADS closures, one per band; every call made
+ *                for band i is passed cl[i]
+ *      nthreads: the number of threads (and bands) to use
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 and cl are not NULL.
+ *      nthreads is positive.
+ *      apply does not itself call UArray2_map_row_major_parallel.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met, or if a thread cannot
+ *              be started. The pool grows to nthreads - 1 workers the first
+ *              time a call needs that many, and the workers then wait for 
+ *              later calls instead of being started and joined each time; 
+ *              they are stopped and joined when the program exits. Calls 
+ *              from different threads take turns with the pool. The order
+ *              is unordered across bands, row-major within a band. Band i
+ *              covers rows [i * height / nthreads, (i + 1) * height / 
+ *              nthreads); if there are more threads than rows, the extra 
+ *              bands are empty and their closures unused.
+ *              Apply runs concurrently, so it must not write shared state
+ *              outside its own band's elements and closure. The calling 
+ *              thread traverses band 0 itself and returns once all bands 
+ *              are done.
+ ************************/
+void UArray2_map_row_major_parallel(UArray2_T U2, 
+                                    void apply(int col, int row, UArray2_T U2,
+                                               void *p1, void *p2), 
+                                    void *cl[], int nthreads) {
+        assert(U2 != NULL);
+        assert(cl != NULL);
+        assert(nthreads > 0);
+        assert_int_dims(U2);
+
+        struct band *bands = malloc(nthreads * sizeof(*bands));
+        assert(bands != NULL);
+        for (int i = 0; i < nthreads; i++) {
+                bands[i].U2 = U2;
+                bands[i].apply = apply;
+                bands[i].cl = cl[i];
+                bands[i].first_row = (int)(i * U2->height / nthreads);
+                bands[i].end_row = (int)((i + 1) * U2->height / nthreads);
+        }
+
+        int err = pthread_mutex_lock(&pool.call);
+        assert(err == 0);
+        grow_pool(nthreads - 1);
+
+        pthread_mutex_lock(&pool.lock);
+        pool.bands = bands;
+        pool.nbands = nthreads;
+        pool.next_band = 1;
+        pool.pending = nthreads - 1;
+        pthread_cond_broadcast(&pool.work);
+        pthread_mutex_unlock(&pool.lock);
+
+        map_band(&bands[0]);
+
+        pthread_mutex_lock(&pool.lock);
+        while (pool.pending > 0) {
+                pthread_cond_wait(&pool.done, &pool.lock);
+        }
+        pool.bands = NULL;
+        pool.nbands = 0;
+        pool.next_band = 0;
+        pthread_mutex_unlock(&pool.lock);
+        pthread_mutex_unlock(&pool.call);
+        free(bands);
+}
+
+/********** grow_pool ********
+ *
+ * Starts workers until the pool has at least NWORKERS of them.
+ * 
+ * Parameters:
+ *      nworkers: the number of workers needed
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      pool.call is held by the caller.
+ *
+ * Notes:
+ *      Will CRE if a thread cannot be started or the memory cannot be 
+ *              allocated. The first time any worker is started, stop_pool
+ *              is registered to run when the program exits.
+ ************************/
+static void grow_pool(int nworkers) {
+        if (nworkers <= pool.nworkers) {
+                return;
+        }
+        if (pool.nworkers == 0) {
+                int err = atexit(stop_pool);
+                assert(err == 0);
+        }
+        pthread_t *threads = realloc(pool.threads, 
+                                     nworkers * sizeof(*threads));
+        assert(threads != NULL);
+        pool.threads = threads;
+        while (pool.nworkers < nworkers) {
+                int err = pthread_create(&pool.threads[pool.nworkers], NULL,
+                                         pool_worker, NULL);
+                assert(err == 0);
+                pool.nworkers++;
+        }
+}
+
+/********** pool_worker ********
+ *
+ * Thread body for the workers of the pool: waits for a band to be handed 
+ * out, traverses it, and repeats until the pool is stopped.
+ * 
+ * Parameters:
+ *      arg: unused
+ *
+ * Return: NULL
+ *
+ * Notes:
+ *      Any worker may take any band after band 0, which the calling thread
+ *              traverses itself; the last worker to finish a band wakes the
+ *              caller.
+ ************************/
+static void *pool_worker(void *arg) {
+        (void)arg;
+        pthread_mutex_lock(&pool.lock);
+        for (;;) {
+                while (!pool.stopping && pool.next_band >= pool.nbands) {
+                        pthread_cond_wait(&pool.work, &pool.lock);
+                }
+                if (pool.stopping) {
+                        break;
+                }
+                struct band *b = &pool.bands[pool.next_band++];
+                pthread_mutex_unlock(&pool.lock);
+
+                map_band(b);
+
+                pthread_mutex_lock(&pool.lock);
+                pool.pending--;
+                if (pool.pending == 0) {
+                        pthread_cond_signal(&pool.done);
                 }
         }
+        pthread_mutex_unlock(&pool.lock);
+        return NULL;
+}
+
+/********** stop_pool ********
+ *
+ * Stops the workers of the pool and joins them; registered with atexit.
+ * 
+ * Return: no return value
+ *
+ * Notes:
+ *      Will CRE if a worker cannot be joined.
+ ************************/
+static void stop_pool(void) {
+        pthread_mutex_lock(&pool.lock);
+        pool.stopping = 1;
+        pthread_cond_broadcast(&pool.work);
+        pthread_mutex_unlock(&pool.lock);
+        for (int i = 0; i < pool.nworkers; i++) {
+                int err = pthread_join(pool.threads[i], NULL);
+                assert(err == 0);
+        }
+        free(pool.threads);
+        pool.threads = NULL;
+        pool.nworkers = 0;
+}
+
+/********** map_band ********
+ *
+ * Traverses one band of rows for UArray2_map_row_major_parallel in 
+ * row-major order.
+ * 
+ * Parameters:
+ *      b: the band to traverse
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      arg describes rows that lie within the array.
+ *
+ * Notes:
+ *      Walks the underlying storage sequentially for a row-major array, like
+ *      UArray2_map_row_major.
+ ************************/
+static void map_band(struct band *b) {
+        int width = (int)b->U2->width;
+        size_t size = b->U2->size;
+
+        if (b->U2->layout == UARRAY2_MORTON) {
+                for (int row_idx = b->first_row; row_idx < b->end_row; 
+                     row_idx++) {
+                        for (int col_idx = 0; col_idx < width; col_idx++) {
+                                b->apply(col_idx, row_idx, b->U2, b->U2->base
+                                         + index_of(b->U2, col_idx, row_idx) 
+                                         * size, b->cl);
+                        }
+                }
+                return;
+        }
+
+        char *elem = b->U2->base + (size_t)b->first_row * width * size;
+        for (int row_idx = b->first_row; row_idx < b->end_row; row_idx++) {
+                for (int col_idx = 0; col_idx < width; col_idx++) {
+                        b->apply(col_idx, row_idx, b->U2, elem, b->cl);
+                        elem += size;
+                }
+        }
+}
+
+/********** UArray2_map_morton ********
+ *
+ * Traverses the 2d array in Z order, calling the apply function at each index.
+ * 
+ * Parameters:
+ *      U2:    pointer to a UArray2_T struct
+ *      apply: a function supplied by the client with the intention of calling 
+ *             it on each index
+ *      cl:    a void pointer again supplied by the client
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Visits tiles in 
+ *              row-major order and the cells of each tile in Z order. For a
+ *              UARRAY2_MORTON array this is storage order, so the traversal 
+ *              walks memory sequentially, skipping only the cells of edge 
+ *              tiles that lie outside the array. A UARRAY2_ROW_MAJOR array is
+ *              visited in the same order.
+ ************************/
+void UArray2_map_morton(UArray2_T U2, 
+                        void apply(int col, int row, UArray2_T U2, void *p1, 
+                                   void *p2), 
+                        void *cl) {
+        assert(U2 != NULL);
+        assert_int_dims(U2);
+        int width = (int)U2->width;
+        int height = (int)U2->height;
+        size_t size = U2->size;
+
+        int tile = 1 << U2->tile_shift;
+        size_t tile_cells = (size_t)tile * tile;
+        size_t tile_start = 0;
+        for (int tile_row = 0; tile_row * tile < height; tile_row++) {
+                for (int tile_col = 0; (size_t)tile_col < U2->tiles_wide;
+                     tile_col++) {
+                        for (size_t z = 0; z < tile_cells; z++) {
+                                int col_idx = tile_col * tile + 
+                                              compact_bits(z);
+                                int row_idx = tile_row * tile + 
+                                              compact_bits(z >> 1);
+                                if (col_idx >= width || row_idx >= height) {
+                                        continue;
+                                }
+                                char *elem = (U2->layout == UARRAY2_MORTON)
+                                        ? U2->base + (tile_start + z) * size
+                                        : U2->base + index_of(U2, col_idx,
+                                                              row_idx) * size;
+                                apply(col_idx, row_idx, U2, elem, cl);
+                        }
+                        tile_start += tile_cells;
+                }
+        }
+}
+
+/********** UArray2_map_rows_span ********
+ *
+ * Traverses the 2d array one row at a time, top to bottom, calling the apply
+ * function once per row with the contiguous elements of that row.
+ * 
+ * Parameters:
+ *      U2:    pointer to a UArray2_T struct
+ *      apply: a function supplied by the client, called with the row index,
+ *             a pointer to the first element of the row, and the number of
+ *             elements in the row
+ *      cl:    a void pointer again supplied by the client
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 is not NULL.
+ *      U2 uses the UARRAY2_ROW_MAJOR layout, so that its rows are contiguous.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Element i of a row is
+ *              at (char *)elems + i * UArray2_size(U2), so a client that
+ *              knows the element type can loop over the row directly. Apply
+ *              is not called for arrays with a width of zero.
+ ************************/
+void UArray2_map_rows_span(UArray2_T U2, 
+                           void apply(int row, void *elems, int count, 
+                                      void *cl), 
+                           void *cl) {
+        assert(U2 != NULL);
+        assert_int_dims(U2);
+        int width = (int)U2->width;
+        int height = (int)U2->height;
+        size_t stride = (size_t)width * U2->size;
+        assert(U2->layout == UARRAY2_ROW_MAJOR);
+        if (width == 0) {
+                return;
+        }
+
+        char *row_start = U2->base;
+        for (int row_idx = 0; row_idx < height; row_idx++) {
+                apply(row_idx, row_start, width, cl);
+                row_start += stride;
+        }
 }
 
 /********** UArray2_free********
@@ -234,11 +1123,304 @@ void UArray2_map_row_major(UArray2_T U2,
  *      U2 is not null and &U2 is not null.
  *
  * Notes:
- *      Will CRE if the above expectations are not met.
+ *      Will CRE if the above expectations are not met. A file-backed array is
+ *              flushed to its file and unmapped; the file itself is kept. An
+ *              array allocated from an arena is left for the arena to 
+ *              release.
  ************************/
 void UArray2_free(UArray2_T *U2) {
         assert(&U2 != NULL);
         assert(U2 != NULL);
-        UArray_free(&(*U2)->U_internal);
+        if ((*U2)->storage == STORAGE_FILE) {
+                UArray2_flush(*U2);
+                if ((*U2)->base != NULL) {
+                        munmap((*U2)->base, (*U2)->length * (*U2)->size);
+                }
+        } else if ((*U2)->storage == STORAGE_SNAPSHOT) {
+                Snapshot_unmap((*U2)->base, (*U2)->length * (*U2)->size);
+        } else if ((*U2)->storage == STORAGE_ARENA) {
+                return;
+        } else {
+                free((*U2)->base);
+        }
         free(*U2);
+}
+
+/********** UArray2_raw ********
+ *
+ * Describes the storage of the 2d array for use with the unchecked accessors
+ * UArray2_raw_at, UArray2_raw_get, and UArray2_raw_put in uarray2.h.
+ *
+ * Parameters:
+ *      U2: pointer to a UArray2_T struct
+ *
+ * Return: A UArray2_rawdata holding the address of the element at (0, 0),
+ *         the number of bytes between the starts of adjacent rows, and the
+ *         size of each element.
+ *
+ * Expects
+ *      U2 is not NULL.
+ *      U2 uses the UARRAY2_ROW_MAJOR layout.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. The base is NULL for
+ *              an array with no elements. The result is only valid until
+ *              UArray2_free is called on U2.
+ ************************/
+UArray2_rawdata UArray2_raw(UArray2_T U2) {
+        assert(U2 != NULL);
+        assert(U2->layout == UARRAY2_ROW_MAJOR);
+
+        UArray2_rawdata R;
+        R.base = U2->base;
+        R.stride = U2->width * U2->size;
+        R.size = U2->size;
+        return R;
+}
+
+/********** spread_bits ********
+ *
+ * Spreads the low 16 bits of x out to the even bit positions of the result,
+ * so that bit i of x becomes bit 2i.
+ *
+ * Parameters:
+ *      x: the value to spread
+ *
+ * Return: The spread value.
+ *
+ * Notes:
+ *      Uses a single PDEP instruction when compiled for a CPU with BMI2 
+ *      (e.g. with -mbmi2 or -march=native), and a shift-and-mask sequence
+ *      otherwise.
+ ************************/
+static inline uint32_t spread_bits(uint32_t x) {
+#if defined(__BMI2__)
+        return _pdep_u32(x, 0x55555555u);
+#else
+        x &= 0x0000ffffu;
+        x = (x | (x << 8)) & 0x00ff00ffu;
+        x = (x | (x << 4)) & 0x0f0f0f0fu;
+        x = (x | (x << 2)) & 0x33333333u;
+        x = (x | (x << 1)) & 0x55555555u;
+        return x;
+#endif
+}
+
+/********** compact_bits ********
+ *
+ * The inverse of spread_bits: gathers the even bits of x into the low 16 bits
+ * of the result.
+ *
+ * Parameters:
+ *      x: the value to compact
+ *
+ * Return: The compacted value.
+ *
+ * Notes:
+ *      Uses PEXT when compiled for a CPU with BMI2.
+ ************************/
+static inline uint32_t compact_bits(uint32_t x) {
+#if defined(__BMI2__)
+        return _pext_u32(x, 0x55555555u);
+#else
+        x &= 0x55555555u;
+        x = (x | (x >> 1)) & 0x33333333u;
+        x = (x | (x >> 2)) & 0x0f0f0f0fu;
+        x = (x | (x >> 4)) & 0x00ff00ffu;
+        x = (x | (x >> 8)) & 0x0000ffffu;
+        return x;
+#endif
+}
+
+/********** index_of ********
+ *
+ * Computes the index in the underlying 1d array of the element at (col, row)
+ * without any checking.
+ *
+ * Parameters:
+ *      U2:  pointer to a UArray2_T struct
+ *      col: the column of the element
+ *      row: the row of the element
+ *
+ * Return: The index of the element.
+ *
+ * Expects
+ *      col and row are in bounds, as checked by the caller.
+ ************************/
+static inline size_t index_of(UArray2_T U2, size_t col, size_t row) {
+        if (U2->layout == UARRAY2_ROW_MAJOR) {
+                return row * U2->width + col;
+        }
+
+        int shift = U2->tile_shift;
+        uint32_t mask = (1u << shift) - 1;
+        size_t tile = (row >> shift) * U2->tiles_wide + (col >> shift);
+        return (tile << (2 * shift)) | spread_bits(col & mask) |
+               (spread_bits(row & mask) << 1);
+}
+
+/********** new_array ********
+ *
+ * Allocates and initializes a heap-backed UArray2_T; shared by the UArray2_new
+ * functions.
+ *
+ * Parameters:
+ *      width:  the width of the 2d array
+ *      height: the height of the 2d array
+ *      size:   the size, in bytes, of each element
+ *      layout: UARRAY2_ROW_MAJOR or UARRAY2_MORTON
+ *
+ * Return: A new UArray2_T with every element zeroed.
+ *
+ * Expects
+ *      Size is positive, and layout is one of the two layouts.
+ *      The size of the block does not overflow a size_t.
+ *      The memory can be allocated.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+static UArray2_T new_array(size_t width, size_t height, size_t size,
+                           UArray2_layout layout) {
+        UArray2_T U2 = new_handle(width, height, size, layout);
+
+        /* calloc checks length * size itself; the explicit check makes an
+           overflow a CRE rather than a failed allocation */
+        mul_checked(U2->length, size);
+        if (U2->length > 0) {
+                U2->base = calloc(U2->length, size);
+                assert(U2->base != NULL);
+        }
+        return U2;
+}
+
+/********** new_handle ********
+ *
+ * Allocates and initializes a UArray2_T with no storage attached yet.
+ *
+ * Parameters:
+ *      width:  the width of the 2d array
+ *      height: the height of the 2d array
+ *      size:   the size, in bytes, of each element
+ *      layout: UARRAY2_ROW_MAJOR or UARRAY2_MORTON
+ *
+ * Return: A new UArray2_T whose length is set, whose base is NULL, and whose
+ *         storage is STORAGE_HEAP.
+ *
+ * Expects
+ *      Size is positive, and layout is one of the two layouts.
+ *      The number of elements does not overflow a size_t.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. A Morton array uses 
+ *              the smallest power-of-two tile side that covers the array, 
+ *              capped at MORTON_TILE_MAX.
+ ************************/
+static UArray2_T new_handle(size_t width, size_t height, size_t size,
+                            UArray2_layout layout) {
+        UArray2_T U2 = malloc(sizeof(*U2));
+        assert(U2 != NULL);
+        set_shape(U2, width, height, size, layout);
+        return U2;
+}
+
+/********** set_shape ********
+ *
+ * Initializes the fields of a UArray2_T that describe its shape, leaving it
+ * with no storage attached.
+ *
+ * Parameters:
+ *      U2:     the struct to initialize
+ *      width:  the width of the 2d array
+ *      height: the height of the 2d array
+ *      size:   the size, in bytes, of each element
+ *      layout: UARRAY2_ROW_MAJOR or UARRAY2_MORTON
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      Size is positive, and layout is one of the two layouts.
+ *      The number of elements does not overflow a size_t.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Sets the length, sets
+ *              base to NULL, and sets the storage to STORAGE_HEAP. Shared by
+ *              new_handle and UArray2_new_in, whose handles come from 
+ *              different places.
+ ************************/
+static void set_shape(UArray2_T U2, size_t width, size_t height, size_t size,
+                      UArray2_layout layout) {
+        assert(size > 0);
+        assert(layout == UARRAY2_ROW_MAJOR || layout == UARRAY2_MORTON);
+
+        U2->width = width;
+        U2->height = height;
+        U2->size = size;
+        U2->layout = layout;
+
+        /* the tiling also defines the visiting order of UArray2_map_morton,
+           so it is computed for both layouts; the tile covers the shorter
+           side, so that a skinny array is not padded out to a square */
+        size_t shortest = (width < height) ? width : height;
+        U2->tile_shift = 0;
+        while (((size_t)1 << U2->tile_shift) < shortest &&
+               (1 << U2->tile_shift) < MORTON_TILE_MAX) {
+                U2->tile_shift++;
+        }
+        size_t tile = (size_t)1 << U2->tile_shift;
+        U2->tiles_wide = width / tile + (width % tile != 0);
+
+        if (layout == UARRAY2_MORTON) {
+                size_t tiles_high = height / tile + (height % tile != 0);
+                U2->length = mul_checked(mul_checked(U2->tiles_wide, 
+                                                     tiles_high), 
+                                         tile * tile);
+        } else {
+                U2->length = mul_checked(width, height);
+        }
+
+        U2->base = NULL;
+        U2->storage = STORAGE_HEAP;
+        U2->shared = 0;
+}
+
+/********** mul_checked ********
+ *
+ * Multiplies two sizes, checking for overflow.
+ *
+ * Parameters:
+ *      a, b: the sizes to multiply
+ *
+ * Return: a * b
+ *
+ * Expects
+ *      a * b fits in a size_t.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+static size_t mul_checked(size_t a, size_t b) {
+        assert(b == 0 || a <= SIZE_MAX / b);
+        return a * b;
+}
+
+/********** assert_int_dims ********
+ *
+ * Checks that the array can be traversed with the int interface.
+ *
+ * Parameters:
+ *      U2: pointer to a UArray2_T struct
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2 is not NULL, and its width and height each fit in an int.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+static void assert_int_dims(UArray2_T U2) {
+        assert(U2 != NULL);
+        assert(U2->width <= INT_MAX);
+        assert(U2->height <= INT_MAX);
 }
\ No newline at end of file
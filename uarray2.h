@@ -10,21 +10,87 @@
  *     structure represents a 2-dimensional array, and it provides functions to
  *     create a new UArray2, access its width, height, and the size of each
  *     in the array, get an element at a given index in the array, traverse
- *     the array in both row-major and column-major fashion, and finally to free
+ *     the array in both row-major and column-major fashion (one element or
+ *     one whole row at a time), and finally to free
  *     all memory associated with the array. In this file, we typedef UArray2_T
  *     to be a pointer to a UArray2_T struct, as defined in the implementation.
  *
+ *     Alongside the checked interface, this file provides an unchecked fast
+ *     path: UArray2_raw returns a UArray2_rawdata describing the underlying
+ *     storage (base pointer, row stride, element size), and the static inline
+ *     UArray2_raw_at/get/put functions index into it directly. These do no
+ *     bounds checking, and a UArray2_rawdata is only valid until the UArray2
+ *     it came from is freed.
+ *
+ *     UArray2_new_layout chooses how elements are stored. UARRAY2_ROW_MAJOR,
+ *     the layout used by UArray2_new, stores each row contiguously. 
+ *     UARRAY2_MORTON stores the array in Z (Morton) order, which keeps cells
+ *     that are close in either direction close in memory, so that row-major 
+ *     and column-major passes over the same array are both cache friendly; 
+ *     UArray2_map_morton walks such an array in storage order. The raw 
+ *     accessors and UArray2_map_rows_span need contiguous rows, so they are
+ *     only available for UARRAY2_ROW_MAJOR arrays.
+ *
+ *     UArray2_new64, UArray2_width64, UArray2_height64, and UArray2_at64 take
+ *     and return size_t, for arrays whose element count does not fit in an
+ *     int. The int interface still works on such arrays as long as the width
+ *     and height each fit in an int.
+ *
+ *     UArray2_map_file creates a UArray2 whose elements live in a 
+ *     memory-mapped file instead of on the heap, for arrays larger than 
+ *     memory or arrays reused across runs. Such an array behaves like any 
+ *     other UArray2; UArray2_flush writes it back early, and UArray2_free 
+ *     writes it back and unmaps it.
+ *
+ *     UArray2_save writes an array to a snapshot (see snapshot.h): a small
+ *     header followed by the raw elements. UArray2_load reads one back into
+ *     the heap, and UArray2_load_mapped maps its elements in place so that
+ *     reloading costs a header read.
+ *
+ *     UArray2_new_in allocates a row-major array, handle and elements alike,
+ *     from a UArray2_Arena (see arena2.h), for programs that create and drop
+ *     many small arrays; UArray2_Arena_reset releases them all at once.
+ *
  ******************************************************************************/
 #ifndef UARRAY2_INCLUDED
 #define UARRAY2_INCLUDED
 
+#include <stddef.h>
+#include <string.h>
+#include "arena2.h"
+#include "snapshot.h"
+
 typedef struct UArray2_T *UArray2_T;
 
+typedef enum { UARRAY2_ROW_MAJOR = 0, UARRAY2_MORTON = 1 } UArray2_layout;
+
+typedef struct UArray2_rawdata {
+        char *base;     /* address of the element at (0, 0) */
+        size_t stride;  /* bytes from the start of one row to the next */
+        size_t size;    /* bytes per element */
+} UArray2_rawdata;
+
 UArray2_T UArray2_new(int width, int height, int size);
+UArray2_T UArray2_new_layout(int width, int height, int size, 
+                             UArray2_layout layout);
+UArray2_T UArray2_new64(size_t width, size_t height, size_t size);
+UArray2_T UArray2_new_in(UArray2_Arena_T arena, int width, int height, 
+                         int size);
+UArray2_T UArray2_map_file(const char *path, size_t width, size_t height, 
+                           size_t size, UArray2_filemode mode);
+extern void UArray2_flush(UArray2_T U2);
+extern void UArray2_save(UArray2_T U2, const char *path);
+UArray2_T UArray2_load(const char *path);
+UArray2_T UArray2_load_mapped(const char *path, UArray2_filemode mode);
+extern int UArray2_is_snapshot(const char *path);
 extern int UArray2_width(UArray2_T U2);
 extern int UArray2_height(UArray2_T U2);
 extern int UArray2_size(UArray2_T U2);
+extern UArray2_layout UArray2_get_layout(UArray2_T U2);
 void *UArray2_at(UArray2_T U2, int col, int row);
+extern size_t UArray2_width64(UArray2_T U2);
+extern size_t UArray2_height64(UArray2_T U2);
+void *UArray2_at64(UArray2_T U2, size_t col, size_t row);
 extern void UArray2_map_col_major(UArray2_T U2, 
                                   void apply(int col, int row, UArray2_T U2, 
                                              void *p1, void *p2), 
@@ -33,6 +99,38 @@ extern void UArray2_map_row_major(UArray2_T U2,
                                   void apply(int col, int row, UArray2_T U2, 
                                              void *p1, void *p2), 
                                   void *cl);
+extern void UArray2_map_morton(UArray2_T U2, 
+                               void apply(int col, int row, UArray2_T U2, 
+                                          void *p1, void *p2), 
+                               void *cl);
+extern void UArray2_map_row_major_parallel(UArray2_T U2, 
+                                           void apply(int col, int row, 
+                                                      UArray2_T U2, void *p1,
+                                                      void *p2), 
+                                           void *cl[], int nthreads);
+extern void UArray2_map_rows_span(UArray2_T U2,
+                                  void apply(int row, void *elems, int count,
+                                             void *cl),
+                                  void *cl);
 extern void UArray2_free(UArray2_T *U2);
 
+extern UArray2_rawdata UArray2_raw(UArray2_T U2);
+
+static inline void *UArray2_raw_at(UArray2_rawdata R, int col, int row)
+{
+        return R.base + (size_t)row * R.stride + (size_t)col * R.size;
+}
+
+static inline void UArray2_raw_get(UArray2_rawdata R, int col, int row,
+                                   void *elem)
+{
+        memcpy(elem, UArray2_raw_at(R, col, row), R.size);
+}
+
+static inline void UArray2_raw_put(UArray2_rawdata R, int col, int row,
+                                   const void *elem)
+{
+        memcpy(UArray2_raw_at(R, col, row), elem, R.size);
+}
+
 #endif
\ No newline at end of file
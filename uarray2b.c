@@ -0,0 +1,393 @@
+/*******************************************************************************
+ *
+ *                     uarray2b.c
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file contains the implementation of the UArray2b data structure.
+ *     Unlike UArray2, which allocates its own block, it still keeps its
+ *     cells in a single 1-dimensional Hanson UArray, so the number of cells
+ *     must fit in an int. The UArray holds the blocks one after another, in
+ *     row-major order of blocks, and each block holds its BLOCKSIZE * 
+ *     BLOCKSIZE cells in row-major order. Blocks on the right and bottom 
+ *     edges are stored whole even when the array does not fill them; those
+ *     cells are never visited.
+ *
+ ******************************************************************************/
+#include "uarray2b.h"
+#include "uarray.h"
+#include "except.h"
+#include "assert.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+
+struct UArray2b_T {
+        int width;
+        int height;
+        int size;
+        int blocksize;
+        int blocks_wide;
+        int blocks_high;
+        UArray_T U_internal;
+        char *base;
+};
+
+static inline char *cell(UArray2b_T U2b, int col, int row);
+
+/********** UArray2b_new ********
+ *
+ * Allocates, initializes, and returns a new UArray2b_T.
+ *
+ * Parameters:
+ *      width:          integer holding the width of the 2d array
+ *      height:         integer holding the height of the 2d array
+ *      size:           integer holding the size, in bytes, of each element
+ *      blocksize:      integer holding the number of cells along each side
+ *                      of a block
+ *
+ * Return: A UArray2b_T, which is a pointer to the UArray2b_T defined at the
+ *         top of this file.
+ *
+ * Expects
+ *      Width is non-negative.
+ *      Height is non-negative.
+ *      Size is positive.
+ *      Blocksize is positive.
+ *      The number of cells, counting the unused cells of the edge blocks,
+ *              fits in an int, as Hanson's UArray requires.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Malloc's memory that
+ *              will be free'd by UArray2b_free.
+ ************************/
+UArray2b_T UArray2b_new(int width, int height, int size, int blocksize) {
+        assert(width >= 0);
+        assert(height >= 0);
+        assert(size > 0);
+        assert(blocksize > 0);
+
+        UArray2b_T U2b = malloc(sizeof(*U2b));
+        assert(U2b != NULL);
+
+        U2b->width = width;
+        U2b->height = height;
+        U2b->size = size;
+        U2b->blocksize = blocksize;
+        U2b->blocks_wide = width / blocksize + (width % blocksize != 0);
+        U2b->blocks_high = height / blocksize + (height % blocksize != 0);
+
+        /* counted in size_t, as the product can be far past INT_MAX */
+        size_t block_cells = (size_t)blocksize * blocksize;
+        size_t blocks = (size_t)U2b->blocks_wide * U2b->blocks_high;
+        assert(block_cells <= INT_MAX && blocks <= INT_MAX / block_cells);
+        int cells = (int)(blocks * block_cells);
+        U2b->U_internal = UArray_new(cells, size);
+        U2b->base = (cells > 0) ? UArray_at(U2b->U_internal, 0) : NULL;
+        return U2b;
+}
+
+/********** UArray2b_new_64K_block ********
+ *
+ * Allocates, initializes, and returns a new UArray2b_T whose blocks are as
+ * large as possible while still fitting in 64KB.
+ *
+ * Parameters:
+ *      width:          integer holding the width of the 2d array
+ *      height:         integer holding the height of the 2d array
+ *      size:           integer holding the size, in bytes, of each element
+ *
+ * Return: A UArray2b_T, as returned by UArray2b_new.
+ *
+ * Expects
+ *      The same as UArray2b_new.
+ *
+ * Notes:
+ *      Uses a blocksize of 1 when a single element is larger than 64KB.
+ ************************/
+UArray2b_T UArray2b_new_64K_block(int width, int height, int size) {
+        assert(size > 0);
+
+        int blocksize = (int)sqrt(65536.0 / size);
+        if (blocksize < 1) {
+                blocksize = 1;
+        }
+        return UArray2b_new(width, height, size, blocksize);
+}
+
+/********** UArray2b_width ********
+ *
+ * Gets the width of the 2d array.
+ *
+ * Parameters:
+ *      A UArray2b_T, which is a pointer to a UArray2b_T struct.
+ *
+ * Return: an integer holding the width of the UArray2b
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+int UArray2b_width(UArray2b_T U2b) {
+        assert(U2b != NULL);
+        return U2b->width;
+}
+
+/********** UArray2b_height ********
+ *
+ * Gets the height of the 2d array.
+ *
+ * Parameters:
+ *      A UArray2b_T, which is a pointer to a UArray2b_T struct.
+ *
+ * Return: an integer holding the height of the UArray2b
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+int UArray2b_height(UArray2b_T U2b) {
+        assert(U2b != NULL);
+        return U2b->height;
+}
+
+/********** UArray2b_size ********
+ *
+ * Gets the size of a single element in the 2d array.
+ *
+ * Parameters:
+ *      A UArray2b_T, which is a pointer to a UArray2b_T struct.
+ *
+ * Return: The size, in bytes, of a single element in the 2d array.
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+int UArray2b_size(UArray2b_T U2b) {
+        assert(U2b != NULL);
+        return U2b->size;
+}
+
+/********** UArray2b_blocksize ********
+ *
+ * Gets the number of cells along each side of a block.
+ *
+ * Parameters:
+ *      A UArray2b_T, which is a pointer to a UArray2b_T struct.
+ *
+ * Return: The blocksize of the 2d array.
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+int UArray2b_blocksize(UArray2b_T U2b) {
+        assert(U2b != NULL);
+        return U2b->blocksize;
+}
+
+/********** UArray2b_at ********
+ *
+ * Gets the element at the provided index in the 2d array.
+ *
+ * Parameters:
+ *      U2b: pointer to a UArray2b_T struct
+ *      col: integer holding the column of the element
+ *      row: integer holding the row of the element
+ *
+ * Return: A void pointer to the element at the provided index.
+ *
+ * Expects
+ *      U2b is not NULL.
+ *      col is non-negative and less than the width of the 2d array.
+ *      row is non-negative and less than the height of the 2d array.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+void *UArray2b_at(UArray2b_T U2b, int col, int row) {
+        assert(U2b != NULL);
+        assert(col >= 0);
+        assert(row >= 0);
+        assert(col < U2b->width);
+        assert(row < U2b->height);
+
+        return cell(U2b, col, row);
+}
+
+/********** UArray2b_map_block_major ********
+ *
+ * Traverses the 2d array one block at a time, calling the apply function at
+ * each index. Blocks are visited in row-major order of blocks, and the cells
+ * of each block in row-major order within the block.
+ *
+ * Parameters:
+ *      U2b:   pointer to a UArray2b_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *             it on each index
+ *      cl:    a void pointer again supplied by the client
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. This is the order in
+ *              which the cells are laid out in memory, so the traversal walks
+ *              the underlying storage sequentially.
+ ************************/
+void UArray2b_map_block_major(UArray2b_T U2b,
+                              void apply(int col, int row, UArray2b_T U2b,
+                                         void *p1, void *p2),
+                              void *cl) {
+        assert(U2b != NULL);
+        int bs = U2b->blocksize;
+        size_t size = U2b->size;
+
+        char *block = U2b->base;
+        for (int block_row = 0; block_row < U2b->blocks_high; block_row++) {
+                int row0 = block_row * bs;
+                int row_end = (row0 + bs < U2b->height) ? row0 + bs
+                                                        : U2b->height;
+                for (int block_col = 0; block_col < U2b->blocks_wide;
+                     block_col++) {
+                        int col0 = block_col * bs;
+                        int col_end = (col0 + bs < U2b->width) ? col0 + bs
+                                                               : U2b->width;
+                        for (int row_idx = row0; row_idx < row_end;
+                             row_idx++) {
+                                char *elem = block + (size_t)(row_idx - row0)
+                                                     * bs * size;
+                                for (int col_idx = col0; col_idx < col_end;
+                                     col_idx++) {
+                                        apply(col_idx, row_idx, U2b, elem, cl);
+                                        elem += size;
+                                }
+                        }
+                        block += (size_t)bs * bs * size;
+                }
+        }
+}
+
+/********** UArray2b_map_col_major ********
+ *
+ * Traverses the 2d array in a column-major fashion, calling the apply function
+ * at each index.
+ *
+ * Parameters:
+ *      U2b:   pointer to a UArray2b_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *             it on each index
+ *      cl:    a void pointer again supplied by the client
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Successive rows of a
+ *              column are BLOCKSIZE elements apart within a block, so a
+ *              column touches one block's worth of cache lines at a time.
+ ************************/
+void UArray2b_map_col_major(UArray2b_T U2b,
+                            void apply(int col, int row, UArray2b_T U2b,
+                                       void *p1, void *p2),
+                            void *cl) {
+        assert(U2b != NULL);
+        for (int col_idx = 0; col_idx < U2b->width; col_idx++) {
+                for (int row_idx = 0; row_idx < U2b->height; row_idx++) {
+                        apply(col_idx, row_idx, U2b,
+                              cell(U2b, col_idx, row_idx), cl);
+                }
+        }
+}
+
+/********** UArray2b_map_row_major ********
+ *
+ * Traverses the 2d array in a row-major fashion, calling the apply function
+ * at each index.
+ *
+ * Parameters:
+ *      U2b:   pointer to a UArray2b_T struct
+ *      apply: a function supplied by the client with the intention of calling
+ *             it on each index
+ *      cl:    a void pointer again supplied by the client
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2b is not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met.
+ ************************/
+void UArray2b_map_row_major(UArray2b_T U2b,
+                            void apply(int col, int row, UArray2b_T U2b,
+                                       void *p1, void *p2),
+                            void *cl) {
+        assert(U2b != NULL);
+        for (int row_idx = 0; row_idx < U2b->height; row_idx++) {
+                for (int col_idx = 0; col_idx < U2b->width; col_idx++) {
+                        apply(col_idx, row_idx, U2b,
+                              cell(U2b, col_idx, row_idx), cl);
+                }
+        }
+}
+
+/********** UArray2b_free ********
+ *
+ * Frees all memory associated with the 2d array.
+ *
+ * Parameters:
+ *      U2b: a pointer to a pointer to a UArray2b_T struct.
+ *
+ * Return: no return value
+ *
+ * Expects
+ *      U2b and *U2b are not NULL.
+ *
+ * Notes:
+ *      Will CRE if the above expectations are not met. Sets *U2b to NULL.
+ ************************/
+void UArray2b_free(UArray2b_T *U2b) {
+        assert(U2b != NULL);
+        assert(*U2b != NULL);
+        UArray_free(&(*U2b)->U_internal);
+        free(*U2b);
+        *U2b = NULL;
+}
+
+/********** cell ********
+ *
+ * Computes the address of the cell at (col, row) without any checking.
+ *
+ * Parameters:
+ *      U2b: pointer to a UArray2b_T struct
+ *      col: integer holding the column of the element
+ *      row: integer holding the row of the element
+ *
+ * Return: A pointer to the cell.
+ *
+ * Expects
+ *      col and row are in bounds, as checked by the caller.
+ ************************/
+static inline char *cell(UArray2b_T U2b, int col, int row) {
+        int bs = U2b->blocksize;
+        size_t block = (size_t)(row / bs) * U2b->blocks_wide + col / bs;
+        size_t offset = block * bs * bs + (size_t)(row % bs) * bs + col % bs;
+        return U2b->base + offset * U2b->size;
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************
+ *
+ *                     uarray2b.h
+ *
+ *     Assignment: iii
+ *     Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ *     Date:     9/28/23
+ *
+ *     This file provides the interface for the UArray2b data structure, a
+ *     blocked 2-dimensional array. It offers the same operations as UArray2
+ *     (new, width, height, size, at, row-major and column-major maps, free),
+ *     but stores its elements in square blocks of BLOCKSIZE x BLOCKSIZE cells,
+ *     with the cells of each block contiguous in memory. The block-major map
+ *     visits the array one block at a time, so its traversal is sequential in
+ *     memory. In this file, we typedef UArray2b_T to be a pointer to a 
+ *     UArray2b_T struct, as defined in the implementation.
+ *
+ ******************************************************************************/
+#ifndef UARRAY2B_INCLUDED
+#define UARRAY2B_INCLUDED
+
+typedef struct UArray2b_T *UArray2b_T;
+
+UArray2b_T UArray2b_new(int width, int height, int size, int blocksize);
+UArray2b_T UArray2b_new_64K_block(int width, int height, int size);
+extern int UArray2b_width(UArray2b_T U2b);
+extern int UArray2b_height(UArray2b_T U2b);
+extern int UArray2b_size(UArray2b_T U2b);
+extern int UArray2b_blocksize(UArray2b_T U2b);
+void *UArray2b_at(UArray2b_T U2b, int col, int row);
+extern void UArray2b_map_block_major(UArray2b_T U2b,
+                                     void apply(int col, int row,
+                                                UArray2b_T U2b, void *p1,
+                                                void *p2),
+                                     void *cl);
+extern void UArray2b_map_col_major(UArray2b_T U2b,
+                                   void apply(int col, int row,
+                                              UArray2b_T U2b, void *p1,
+                                              void *p2),
+                                   void *cl);
+extern void UArray2b_map_row_major(UArray2b_T U2b,
+                                   void apply(int col, int row,
+                                              UArray2b_T U2b, void *p1,
+                                              void *p2),
+                                   void *cl);
+extern void UArray2b_free(UArray2b_T *U2b);
+
+#endif
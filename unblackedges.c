@@ -10,62 +10,272 @@
  *     and removes all black edge pixels from the file. It utilizes our 
  *     2-dimensional Bit structure, Bit2, to represent the file.
  *
+ *     Usage: unblackedges [--snapshot=PATH] [--algo=scanline|dfs|sweep] 
+ *                         [-j N] [--stream] [--raw] [file]
+ *     With --snapshot, the parsed image is also saved to PATH as a Bit2 
+ *     snapshot before any edges are removed. The black edges are removed 
+ *     with the scanline flood fill of Bit2_flood_clear; with --algo=dfs, 
+ *     with our original depth-first search a pixel at a time, kept for 
+ *     comparison; or, with --algo=sweep, by growing the black border pixels
+ *     into the image with Bit2_spread, which needs no stack at all. With 
+ *     -j N, which cannot be combined with --algo=, N threads each label the
+ *     black runs of one horizontal stripe of the image, joining touching 
+ *     runs in a shared lock-free union-find, and then clear the runs joined
+ *     to the border. With --stream, which cannot be combined with -j, 
+ *     --algo=, or --snapshot, the pbm is read a row at a time and each row 
+ *     is printed as soon as every black run in it is known either to reach
+ *     the border or to be cut off from it, so only the rows still in doubt
+ *     are kept.
+ *     The result is printed as a plain (P1) pbm, or, with --raw, as a raw 
+ *     (P4) pbm, packed 8 pixels to a byte.
+ *     A snapshot may be given in place of a pbm, in which case it is mapped 
+ *     in place rather than parsed. A raw (P4) pbm named on the command line
+ *     is also mapped rather than parsed: its pixels are already packed 8 to a
+ *     byte, so the Bit2 is a view of the mapped bytes (see Pnmread_view),
+ *     and the map is private, so removing edges never changes the file.
+ *
  ******************************************************************************/
+#define _POSIX_C_SOURCE 200809L
 
 #include "bit2.h"
 #include "except.h"
 #include "assert.h"
-#include "pnmrdr.h"
-#include "stack.h"
+#include "pnmread.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 
-static FILE *open_or_abort(char *fname, char *mode);
-void check_pbm_header(Pnmrdr_T *reader, unsigned *width, unsigned *height);
-void populate_Bit2(Bit2_T B2, Pnmrdr_T *reader);
-void run_DFS(int start_col, int start_row, Bit2_T B2, int start_val, 
-             Stack_T S);
-void print_pbm(Bit2_T B2);
+/* 
+ * pixels waiting to be searched, each packed into one word as 
+ * (row << 32) | col; the array grows by doubling and is reused by every 
+ * search, so a search makes no allocations once it is big enough
+ */
+struct work_stack {
+        uint64_t *pixels;
+        size_t count;
+        size_t capacity;
+};
 
-struct pixel {
-        int col;
-        int row;
+/* a run of black pixels in one row, covering columns [start, end) */
+struct run {
+        int start;
+        int end;
 };
 
+/* 
+ * one horizontal stripe of rows, handled by a single thread; the runs of 
+ * every row are numbered in row-major order, starting at FIRST_LABEL, and 
+ * row_first[row] is the label of the first run in row, so that a row can be
+ * scanned again at any time to recover the labels of its runs
+ */
+struct stripe {
+        Bit2_T B2;
+        int first_row;
+        int end_row;
+        uint32_t *row_first;    /* shared by all stripes */
+        uint32_t *parent;       /* shared union-find; 0 marks a root */
+        struct run *runs;       /* two rows' worth, private to the stripe */
+        pthread_t thread;
+};
+
+/* 
+ * the state of a streaming edge removal: a window of the rows read but not 
+ * yet printed, kept as a ring, and a union-find over the black runs of those
+ * rows and of the last row read; the runs of each row are numbered from
+ * row_first, and are renumbered from FIRST_LABEL whenever the labels run 
+ * out, dropping the labels of rows that are gone
+ */
+struct stream {
+        int width;
+        int height;
+        Bit2_T window;          /* row r is kept in row r % capacity */
+        int capacity;
+        int first_row;          /* the oldest row not yet printed */
+        int end_row;            /* one past the last row read */
+        uint32_t *row_first;    /* per window row, label of its first run */
+        int *row_count;         /* per window row, the number of runs */
+        uint32_t *parent;       /* 0 marks a root */
+        unsigned char *closed;  /* per root, no more runs can join it */
+        uint32_t *seen;         /* per root, 1 + the last row it was seen in */
+        uint32_t labels;        /* the next free label */
+        uint32_t label_capacity;
+        struct run *above;      /* the runs of the last row read */
+        int n_above;
+        struct run *below;      /* scratch for the runs of a row */
+        uint64_t *words;        /* scratch for printing a row */
+        struct pbm_writer *writer;
+};
+
+/* 
+ * output to a pbm file: rows are formatted into buffer, which is written out
+ * whenever the next row will not fit
+ */
+struct pbm_writer {
+        FILE *out;
+        int raw;                /* P4 rather than P1 */
+        char *buffer;
+        size_t used;
+        size_t size;
+};
+
+/* label of the imaginary component that every border run is joined to */
+#define BORDER 1
+#define FIRST_LABEL 2
+
+static FILE *open_or_abort(char *fname, char *mode);
+void check_pbm_header(Pnmread_T *reader, unsigned *width, unsigned *height);
+void populate_Bit2(Bit2_T B2, Pnmread_T *reader);
+void run_DFS(int start_col, int start_row, Bit2_T B2, int start_val, 
+             void *cl);
+void clear_from_edge(int col, int row, Bit2_T B2, int val, void *cl);
+void remove_by_sweeps(Bit2_T B2);
+void seed_from_edge(int col, int row, Bit2_T B2, int val, void *cl);
+void print_pbm(Bit2_T B2, int raw);
+void print_row(int row, uint64_t *words, int count, void *cl);
+static void start_pbm(struct pbm_writer *W, FILE *out, int raw, int width,
+                      int height);
+static void finish_pbm(struct pbm_writer *W);
+static void push_pixel(struct work_stack *S, int col, int row);
+static void remove_by_stripes(Bit2_T B2, int nthreads);
+static void run_stripes(struct stripe *stripes, int nthreads, 
+                        void *body(void *arg));
+static void *count_stripe(void *arg);
+static void *label_stripe(void *arg);
+static void *clear_stripe(void *arg);
+static int row_runs(Bit2_T B2, int row, struct run *runs);
+static void join_rows(uint32_t *parent, struct run *above, int n_above, 
+                      uint32_t first_above, struct run *below, int n_below,
+                      uint32_t first_below);
+static uint32_t find_label(uint32_t *parent, uint32_t label);
+static void unite_labels(uint32_t *parent, uint32_t a, uint32_t b);
+static void clear_columns(Bit2_T B2, int row, int start, int end);
+static void join_border(uint32_t *parent, struct run *runs, int n, 
+                        uint32_t first, int row, int width, int height);
+static void remove_streaming(Pnmread_T *reader, int width, int height, 
+                             int raw);
+static void close_components(struct stream *S, int row, int n_below, 
+                             uint32_t first_below);
+static int print_if_known(struct stream *S);
+static void grow_window(struct stream *S);
+static void reserve_labels(struct stream *S, uint32_t need);
+static void renumber_labels(struct stream *S);
+
 int main(int argc, char *argv[]) 
 {
+        /* optional --snapshot=PATH saves the parsed image for fast reloads,
+           and --algo= picks how black edges are removed */
+        char *snapshot = NULL;
+        enum { ALGO_SCANLINE, ALGO_DFS, ALGO_SWEEP } algo = ALGO_SCANLINE;
+        int algo_given = 0;
+        int nthreads = 0;
+        int stream = 0;
+        int raw = 0;
+        while (argc > 1 && (strncmp(argv[1], "--", 2) == 0 || 
+                            strcmp(argv[1], "-j") == 0)) {
+                if (strcmp(argv[1], "-j") == 0) {
+                        /* -j N: remove edges with N threads */
+                        assert(argc > 2);
+                        nthreads = atoi(argv[2]);
+                        assert(nthreads > 0);
+                        argv++;
+                        argc--;
+                } else if (strcmp(argv[1], "--stream") == 0) {
+                        stream = 1;
+                } else if (strcmp(argv[1], "--raw") == 0) {
+                        raw = 1;
+                } else if (strncmp(argv[1], "--snapshot=", 11) == 0) {
+                        snapshot = argv[1] + 11;
+                } else if (strcmp(argv[1], "--algo=dfs") == 0) {
+                        algo = ALGO_DFS;
+                        algo_given = 1;
+                } else if (strcmp(argv[1], "--algo=sweep") == 0) {
+                        algo = ALGO_SWEEP;
+                        algo_given = 1;
+                } else {
+                        assert(strcmp(argv[1], "--algo=scanline") == 0);
+                        algo = ALGO_SCANLINE;
+                        algo_given = 1;
+                }
+                argv++;
+                argc--;
+        }
         assert(argc <= 2);
-        FILE *fp;
-        if (argc == 1) {
-                fp = stdin;
-        } else {
-                fp = open_or_abort(argv[1], "r");
+
+        /* -j and --stream each have an algorithm of their own, so asking for
+           another as well is an error rather than being ignored */
+        assert(nthreads == 0 || !algo_given);
+        assert(!stream || (nthreads == 0 && !algo_given));
+
+        if (stream) {
+                /* the image is never held whole, so it cannot be saved */
+                assert(snapshot == NULL);
+                FILE *fp = (argc == 1) ? stdin : open_or_abort(argv[1], "r");
+                Pnmread_T reader = Pnmread_new(fp);
+                unsigned width = 0;
+                unsigned height = 0;
+                check_pbm_header(&reader, &width, &height);
+                remove_streaming(&reader, width, height, raw);
+                Pnmread_free(&reader);
+                fclose(fp);
+                return EXIT_SUCCESS;
         }
 
-        Pnmrdr_T reader = Pnmrdr_new(fp);
-        unsigned width = 0;
-        unsigned height = 0;
+        Bit2_T B2 = NULL;
+        Pnmread_T reader = NULL;
+        if (argc == 2 && Bit2_is_snapshot(argv[1])) {
+                /* a saved image is mapped copy-on-write, with no parsing */
+                B2 = Bit2_load_mapped(argv[1], UARRAY2_FILE_PRIVATE);
+                assert(Bit2_width(B2) > 0 && Bit2_height(B2) > 0);
+        } else {
+                FILE *fp;
+                if (argc == 1) {
+                        fp = stdin;
+                } else {
+                        fp = open_or_abort(argv[1], "r");
+                }
+
+                reader = Pnmread_new(fp);
+                unsigned width = 0;
+                unsigned height = 0;
 
-        /* use pnmrdr to read pbm and transfer it into 2d bit array*/
-        check_pbm_header(&reader, &width, &height);
-        Bit2_T B2 = Bit2_new(width, height);
-        populate_Bit2(B2, &reader);
-        Stack_T S = Stack_new();
+                /* use pnmread to read pbm and transfer it into 2d bit array;
+                   a raw pbm in a file needs no unpacking, so the array is a 
+                   view of the file, which the reader keeps mapped */
+                check_pbm_header(&reader, &width, &height);
+                B2 = Pnmread_view(reader);
+                if (B2 == NULL) {
+                        B2 = Bit2_new(width, height);
+                        populate_Bit2(B2, &reader);
+                }
+                fclose(fp);
+        }
+        if (snapshot != NULL) {
+                Bit2_save(B2, snapshot);
+        }
+        struct work_stack S = { NULL, 0, 0 };
         
-        /* loop through 2d bit array and do a depth-first-search on each*/
-        for (int row = 0; row < Bit2_height(B2); row++) {
-                for (int col = 0; col < Bit2_width(B2); col++) {
-                        run_DFS(col, row, B2, Bit2_get(B2, col, row), S);
-                }                   
+        /* clear the region around each black pixel on the border, the only
+           pixels that can start one; the border is read as it is visited, 
+           so pixels turned white by earlier fills are skipped */
+        if (nthreads > 0) {
+                remove_by_stripes(B2, nthreads);
+        } else if (algo == ALGO_DFS) {
+                Bit2_map_border(B2, run_DFS, &S);
+        } else if (algo == ALGO_SWEEP) {
+                remove_by_sweeps(B2);
+        } else {
+                Bit2_map_border(B2, clear_from_edge, NULL);
         }
 
-        print_pbm(B2);
+        print_pbm(B2, raw);
 
         /* free and clean!!! */
-        Stack_free(&S);
-        Pnmrdr_free(&reader);
+        free(S.pixels);
         Bit2_free(&B2);
-        fclose(fp);
+        if (reader != NULL) {
+                Pnmread_free(&reader);
+        }
         return EXIT_SUCCESS;
 }
 
@@ -99,22 +309,22 @@ static FILE *open_or_abort(char *fname, char *mode)
  * reference.
  * 
  * Parameters:
- *      Pnmrdr_T *reader: address of the Pnmrdr object
+ *      Pnmread_T *reader: address of the Pnmread object
  *      unsigned *width:  int to hold the width of input pnm
  *      unsigned *height: int to hold the height of input pnm
  *
  * Return: Doesn't return anything.
  *
  * Expects
- *      the type is either P1 or P4 (both fall under pnmrdr_mapdata.type == 2)
+ *      the type is either P1 or P4 (both fall under Pnmread_bit)
  *      the width and height > 0
  * Notes:
  *      Will CRE if any of the above expects are not met.
  ************************/
-void check_pbm_header(Pnmrdr_T *reader, unsigned *width, unsigned *height) 
+void check_pbm_header(Pnmread_T *reader, unsigned *width, unsigned *height) 
 {
-        Pnmrdr_mapdata header_data = Pnmrdr_data(*reader);
-        assert(header_data.type == 1);
+        Pnmread_mapdata header_data = Pnmread_data(*reader);
+        assert(header_data.type == Pnmread_bit);
         assert(header_data.width > 0);
         assert(header_data.height > 0);
         
@@ -124,131 +334,933 @@ void check_pbm_header(Pnmrdr_T *reader, unsigned *width, unsigned *height)
 
 /********** populate_Bit2 ********
  *
- * Populates the Bit2_T struct using the values read from the pnm by the pnmrdr 
- * object.
+ * Populates the Bit2_T struct using the values read from the pnm by the 
+ * pnmread object.
  *
  * Parameters:
  *      Bit2_T B2: a pointer to a Bit2_T struct
- *      Pnmrdr_T *reader: address of the Pnmrdr object
+ *      Pnmread_T *reader: address of the Pnmread object
  *
  * Return: Doesn't return anything.
  *
  * Expects
- *      Bit2_T and Pnmrdr_T are not NULL, as checked in previous functions
+ *      Bit2_T and Pnmread_T are not NULL, as checked in previous functions
  *      Expects the value of the input pixels to be either 0 or 1
  * Notes:
- *      No additional notes.
+ *      Reads a whole row at a time with Pnmread_bits, which stores the row
+ *      a word at a time rather than storing the pixels one by one.
  ************************/
-void populate_Bit2(Bit2_T B2, Pnmrdr_T *reader) 
+void populate_Bit2(Bit2_T B2, Pnmread_T *reader) 
 {
         for (int row = 0; row < Bit2_height(B2); row++) {
-                for (int col = 0; col < Bit2_width(B2); col++) {
-                        unsigned temp = Pnmrdr_get(*reader);
-                        assert(temp == 1 || temp == 0);
-                        /*We cast temp as an int. While we understand that 
-                        casting an unsigned to an int with very large numbers
-                        can be dangerous, we expect this value to either be 1
-                        or 0, as asserted in the line above.*/
-                        Bit2_put(B2, col, row, (int)temp); 
-                }
+                Pnmread_bits(*reader, B2, row);
         }
 }
 
 /********** run_DFS ********
  *
- * Takes in a pixel, checks whether it is a black edge pixel. If it is, we run
- * DFS from that pixel, moving through all adjacent pixels and turning all
- * black pixels involved white.
+ * Takes in a pixel on the edge of the image and checks whether it is black.
+ * If it is, we run DFS from that pixel, moving through all adjacent pixels 
+ * and turning all black pixels involved white.
  *
  * Parameters:
  *      int start_col: int for starting column of DFS
  *      int start_row: int for starting row of DFS
  *      Bit2_T B2: a pointer to a Bit2_T struct
  *      int start_val: value of starting pixel for DFS
- *      Stack_T S : a stack
+ *      void *cl: the work stack, which is empty and is left empty
  *
  * Return: Doesn't return anything. 
  *
  * Expects
  *      Bit2_T is not NULL, as checked in previous functions
  * Notes:
- *      This function is run on each pixel in the array, with the first two if
- *      cases checking whether it is black and whether it's on the edge. If so,
- *      it begins DFS from that point, progressing through all adjacent black
- *      pixels.
+ *      This function is run by Bit2_map_border on each edge pixel. If the 
+ *      pixel is black, it begins DFS from that point, progressing through all
+ *      adjacent black pixels. Each pixel is turned white as it is pushed, so
+ *      that no pixel is pushed twice.
  ************************/
-void run_DFS(int start_col, int start_row, Bit2_T B2, int start_val, Stack_T S) 
+void run_DFS(int start_col, int start_row, Bit2_T B2, int start_val, 
+             void *cl) 
 {
-        /* if the current pixel is a white pixel or not an edge pixel, return */
+        struct work_stack *S = cl;
+        int width = Bit2_width(B2);
+        int height = Bit2_height(B2);
+
+        /* if the current pixel is a white pixel, return */
         if (start_val == 0) {
                 return;
         }
-        if (!(start_col == 0 ||
-              start_row == 0 || 
-              start_col == (Bit2_width(B2) - 1) || 
-              start_row == (Bit2_height(B2) - 1))) {
-                return;
-        }
 
-        struct pixel *start = malloc(8);
-        start->col = start_col;
-        start->row = start_row;
-        Bit2_put(B2, start->col, start->row, 0);
-        Stack_push(S, start);
+        Bit2_put(B2, start_col, start_row, 0);
+        push_pixel(S, start_col, start_row);
 
         /* depth first search starting with an edge pixel */
-        while (Stack_empty(S) != 1) {
-                struct pixel *curr_pixel = Stack_pop(S);
+        while (S->count > 0) {
+                uint64_t curr = S->pixels[--S->count];
+                int col = (int)(curr & 0xFFFFFFFF);
+                int row = (int)(curr >> 32);
                 /* check pixel to right of current */
-                if (curr_pixel->col + 1 < Bit2_width(B2)) { 
-                        if (Bit2_get(B2, curr_pixel->col + 1, 
-                                     curr_pixel->row) == 1) {
-                                struct pixel *new_pixel1 = malloc(8);
-                                new_pixel1->col = curr_pixel->col + 1;
-                                new_pixel1->row = curr_pixel->row;
-                                Bit2_put(B2, new_pixel1->col, new_pixel1->row,
-                                         0);
-                                Stack_push(S, new_pixel1);
-                        }
+                if (col + 1 < width && Bit2_get(B2, col + 1, row) == 1) {
+                        Bit2_put(B2, col + 1, row, 0);
+                        push_pixel(S, col + 1, row);
                 }
                 /* check pixel to left of current */
-                if (curr_pixel->col - 1 >= 0) { 
-                        if (Bit2_get(B2, curr_pixel->col - 1, 
-                                     curr_pixel->row) == 1) {
-                                struct pixel *new_pixel2 = malloc(8);
-                                new_pixel2->col = curr_pixel->col - 1;
-                                new_pixel2->row = curr_pixel->row;
-                                Bit2_put(B2, new_pixel2->col, new_pixel2->row, 
-                                         0);
-                                Stack_push(S, new_pixel2);
-                        }
+                if (col - 1 >= 0 && Bit2_get(B2, col - 1, row) == 1) {
+                        Bit2_put(B2, col - 1, row, 0);
+                        push_pixel(S, col - 1, row);
                 }
                 /* check pixel below current */
-                if (curr_pixel->row + 1 < Bit2_height(B2)) {
-                        if (Bit2_get(B2, curr_pixel->col,
-                                     curr_pixel->row + 1) == 1) {
-                                struct pixel *new_pixel3 = malloc(8);
-                                new_pixel3->col = curr_pixel->col;
-                                new_pixel3->row = curr_pixel->row + 1;
-                                Bit2_put(B2, new_pixel3->col, new_pixel3->row,
-                                         0);
-                                Stack_push(S, new_pixel3);
-                        }
+                if (row + 1 < height && Bit2_get(B2, col, row + 1) == 1) {
+                        Bit2_put(B2, col, row + 1, 0);
+                        push_pixel(S, col, row + 1);
                 }
                 /* check pixel above current */
-                if (curr_pixel->row - 1 >= 0) {
-                        if (Bit2_get(B2, curr_pixel->col,
-                                     curr_pixel->row - 1) == 1) { 
-                                struct pixel *new_pixel4 = malloc(8);
-                                new_pixel4->col = curr_pixel->col;
-                                new_pixel4->row = curr_pixel->row - 1;
-                                Bit2_put(B2, new_pixel4->col, new_pixel4->row,
-                                         0);
-                                Stack_push(S, new_pixel4);
+                if (row - 1 >= 0 && Bit2_get(B2, col, row - 1) == 1) {
+                        Bit2_put(B2, col, row - 1, 0);
+                        push_pixel(S, col, row - 1);
+                }
+        }
+}
+
+/********** clear_from_edge ********
+ *
+ * Clears the black region around a pixel on the edge of the image, if the
+ * pixel is black, with a scanline flood fill.
+ *
+ * Parameters:
+ *      int col: the column of the edge pixel
+ *      int row: the row of the edge pixel
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int val: value of the edge pixel
+ *      void *cl: unused closure
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      Bit2_T is not NULL, as checked in previous functions
+ * Notes:
+ *      This function is run by Bit2_map_border on each edge pixel.
+ ************************/
+void clear_from_edge(int col, int row, Bit2_T B2, int val, void *cl)
+{
+        (void)cl;
+        if (val == 1) {
+                Bit2_flood_clear(B2, col, row);
+        }
+}
+
+/********** remove_by_sweeps ********
+ *
+ * Removes the black edges of the image without a stack: the black pixels on
+ * the border are grown into every black pixel connected to them, and those
+ * pixels are then all cleared at once.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      Bit2_T is not NULL, as checked in previous functions
+ * Notes:
+ *      Allocates a second Bit2 the size of the image for the black edges.
+ ************************/
+void remove_by_sweeps(Bit2_T B2)
+{
+        Bit2_T edges = Bit2_new(Bit2_width(B2), Bit2_height(B2));
+        Bit2_map_border(B2, seed_from_edge, edges);
+        Bit2_spread(edges, B2);
+        Bit2_andnot(B2, B2, edges);
+        Bit2_free(&edges);
+}
+
+/********** seed_from_edge ********
+ *
+ * Copies a pixel on the edge of the image into the Bit2 of black edges.
+ *
+ * Parameters:
+ *      int col: the column of the edge pixel
+ *      int row: the row of the edge pixel
+ *      Bit2_T B2: a pointer to a Bit2_T struct (unused)
+ *      int val: value of the edge pixel
+ *      void *cl: the Bit2_T of black edges
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      This function is run by Bit2_map_border on each edge pixel.
+ ************************/
+void seed_from_edge(int col, int row, Bit2_T B2, int val, void *cl)
+{
+        (void)B2;
+        Bit2_put(cl, col, row, val);
+}
+
+/********** remove_by_stripes ********
+ *
+ * Removes the black edges of the image with several threads, each working on
+ * one horizontal stripe of rows. The black runs of every row are joined to
+ * the runs they touch in the row above, and the runs on the border to an 
+ * imaginary BORDER run, in a union-find shared by all the threads; the runs
+ * that end up joined to BORDER are then cleared.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int nthreads: the number of threads (and stripes) to use
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      Bit2_T is not NULL, as checked in previous functions
+ *      nthreads is positive
+ *      the image has fewer than 2^32 - 2 black runs
+ * Notes:
+ *      Will CRE if the memory cannot be allocated or a thread cannot be 
+ *      started. Works in three rounds, each run by every thread at once: 
+ *      counting the runs of each row, labelling them, and clearing them. 
+ *      Only the union-find lives from one round to the next, at four bytes 
+ *      per run; the runs themselves are found again from the image when 
+ *      they are needed. Stripe i covers rows [i * height / nthreads, 
+ *      (i + 1) * height / nthreads), and there are never more stripes than 
+ *      rows.
+ ************************/
+static void remove_by_stripes(Bit2_T B2, int nthreads)
+{
+        int width = Bit2_width(B2);
+        int height = Bit2_height(B2);
+        assert(nthreads > 0);
+        if (nthreads > height) {
+                nthreads = height;
+        }
+        if (nthreads == 0) {
+                return;
+        }
+
+        uint32_t *row_first = malloc(((size_t)height + 1) * sizeof(uint32_t));
+        struct stripe *stripes = malloc(nthreads * sizeof(*stripes));
+        assert(row_first != NULL && stripes != NULL);
+        for (int i = 0; i < nthreads; i++) {
+                stripes[i].B2 = B2;
+                stripes[i].first_row = (int)((long)i * height / nthreads);
+                stripes[i].end_row = (int)((long)(i + 1) * height / nthreads);
+                stripes[i].row_first = row_first;
+                stripes[i].parent = NULL;
+                stripes[i].runs = malloc(((size_t)width + 1) / 2 * 2 * 
+                                         sizeof(struct run));
+                assert(stripes[i].runs != NULL);
+        }
+
+        /* number the runs in row-major order from the count in each row */
+        run_stripes(stripes, nthreads, count_stripe);
+        uint32_t label = FIRST_LABEL;
+        for (int row = 0; row < height; row++) {
+                uint32_t count = row_first[row];
+                assert(count < UINT32_MAX - label);
+                row_first[row] = label;
+                label += count;
+        }
+        row_first[height] = label;
+
+        /* every run starts out a root of its own */
+        uint32_t *parent = calloc(label, sizeof(uint32_t));
+        assert(parent != NULL);
+        for (int i = 0; i < nthreads; i++) {
+                stripes[i].parent = parent;
+        }
+        run_stripes(stripes, nthreads, label_stripe);
+        run_stripes(stripes, nthreads, clear_stripe);
+
+        for (int i = 0; i < nthreads; i++) {
+                free(stripes[i].runs);
+        }
+        free(parent);
+        free(stripes);
+        free(row_first);
+}
+
+/********** run_stripes ********
+ *
+ * Runs a function on every stripe at once, one thread per stripe, and waits
+ * for them all to finish.
+ *
+ * Parameters:
+ *      struct stripe *stripes: the stripes
+ *      int nthreads: the number of stripes
+ *      body: the function to run, passed a pointer to its stripe
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if a thread cannot be started. The calling thread runs 
+ *      stripe 0 itself, as in UArray2_map_row_major_parallel.
+ ************************/
+static void run_stripes(struct stripe *stripes, int nthreads, 
+                        void *body(void *arg))
+{
+        for (int i = 1; i < nthreads; i++) {
+                int err = pthread_create(&stripes[i].thread, NULL, body, 
+                                         &stripes[i]);
+                assert(err == 0);
+        }
+        body(&stripes[0]);
+        for (int i = 1; i < nthreads; i++) {
+                pthread_join(stripes[i].thread, NULL);
+        }
+}
+
+/********** count_stripe ********
+ *
+ * Thread body that stores the number of black runs in each row of a stripe 
+ * in row_first, to be turned into labels once every stripe is counted.
+ *
+ * Parameters:
+ *      void *arg: pointer to the struct stripe
+ *
+ * Return: NULL
+ *
+ * Notes:
+ *      A run starts at every 1 bit whose left neighbor is 0, so the runs of
+ *      a row are counted a word at a time without finding them.
+ ************************/
+static void *count_stripe(void *arg)
+{
+        struct stripe *s = arg;
+        int words = Bit2_words_per_row(s->B2);
+        for (int row = s->first_row; row < s->end_row; row++) {
+                uint64_t carry = 0;
+                uint32_t count = 0;
+                for (int w = 0; w < words; w++) {
+                        uint64_t x = Bit2_get_word(s->B2, w, row);
+                        count += __builtin_popcountll(x & ~((x << 1) | 
+                                                            carry));
+                        carry = x >> 63;
+                }
+                s->row_first[row] = count;
+        }
+        return NULL;
+}
+
+/********** label_stripe ********
+ *
+ * Thread body that joins each black run of a stripe to the runs it touches 
+ * in the row above, and the runs on the border of the image to BORDER.
+ *
+ * Parameters:
+ *      void *arg: pointer to the struct stripe
+ *
+ * Return: NULL
+ *
+ * Notes:
+ *      The first row of the stripe is joined to the last row of the stripe 
+ *      above, which is only read; the image is not changed in this round.
+ *      Runs touch when they share a column, as pixels only join their four
+ *      neighbors.
+ ************************/
+static void *label_stripe(void *arg)
+{
+        struct stripe *s = arg;
+        int width = Bit2_width(s->B2);
+        int height = Bit2_height(s->B2);
+        struct run *above = s->runs;
+        struct run *below = s->runs + ((size_t)width + 1) / 2;
+        int n_above = 0;
+        if (s->first_row > 0) {
+                n_above = row_runs(s->B2, s->first_row - 1, above);
+        }
+
+        for (int row = s->first_row; row < s->end_row; row++) {
+                int n = row_runs(s->B2, row, below);
+                uint32_t first = s->row_first[row];
+                join_border(s->parent, below, n, first, row, width, height);
+                if (row > 0) {
+                        join_rows(s->parent, above, n_above, 
+                                  s->row_first[row - 1], below, n, first);
+                }
+
+                struct run *swap = above;
+                above = below;
+                below = swap;
+                n_above = n;
+        }
+        return NULL;
+}
+
+/********** clear_stripe ********
+ *
+ * Thread body that clears every black run of a stripe that is joined to 
+ * BORDER.
+ *
+ * Parameters:
+ *      void *arg: pointer to the struct stripe
+ *
+ * Return: NULL
+ *
+ * Notes:
+ *      Writes only the rows of its own stripe.
+ ************************/
+static void *clear_stripe(void *arg)
+{
+        struct stripe *s = arg;
+        for (int row = s->first_row; row < s->end_row; row++) {
+                int n = row_runs(s->B2, row, s->runs);
+                uint32_t first = s->row_first[row];
+                for (int k = 0; k < n; k++) {
+                        if (find_label(s->parent, first + k) == BORDER) {
+                                clear_columns(s->B2, row, s->runs[k].start,
+                                              s->runs[k].end);
+                        }
+                }
+        }
+        return NULL;
+}
+
+/********** row_runs ********
+ *
+ * Finds the runs of black pixels in a row, from left to right.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int row: the row
+ *      struct run *runs: where to store the runs
+ *
+ * Return: the number of runs found
+ *
+ * Expects
+ *      runs has room for (width + 1) / 2 runs, the most a row can hold
+ ************************/
+static int row_runs(Bit2_T B2, int row, struct run *runs)
+{
+        int words = Bit2_words_per_row(B2);
+        int count = 0;
+        int open = -1;          /* start of a run still going */
+        for (int w = 0; w < words; w++) {
+                uint64_t x = Bit2_get_word(B2, w, row);
+                int bit = 0;
+                while (bit < 64) {
+                        if (open < 0) {
+                                uint64_t rest = x >> bit;
+                                if (rest == 0) {
+                                        break;
+                                }
+                                bit += __builtin_ctzll(rest);
+                                open = w * 64 + bit;
+                        }
+                        uint64_t gaps = ~x >> bit;
+                        if (gaps == 0) {
+                                break;  /* into the next word */
+                        }
+                        bit += __builtin_ctzll(gaps);
+                        runs[count].start = open;
+                        runs[count].end = w * 64 + bit;
+                        count++;
+                        open = -1;
+                }
+        }
+        if (open >= 0) {
+                runs[count].start = open;
+                runs[count].end = Bit2_width(B2);
+                count++;
+        }
+        return count;
+}
+
+/********** join_rows ********
+ *
+ * Joins every run of a row to each run of the row above that shares a 
+ * column with it.
+ *
+ * Parameters:
+ *      uint32_t *parent: the union-find
+ *      struct run *above, int n_above: the runs of the upper row
+ *      uint32_t first_above: the label of the first run of the upper row
+ *      struct run *below, int n_below: the runs of the lower row
+ *      uint32_t first_below: the label of the first run of the lower row
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Both lists are sorted, so they are walked together like a merge: 
+ *      whichever run ends first cannot touch anything further along.
+ ************************/
+static void join_rows(uint32_t *parent, struct run *above, int n_above, 
+                      uint32_t first_above, struct run *below, int n_below,
+                      uint32_t first_below)
+{
+        int i = 0;
+        int j = 0;
+        while (i < n_above && j < n_below) {
+                if (above[i].start < below[j].end && 
+                    below[j].start < above[i].end) {
+                        unite_labels(parent, first_above + i, 
+                                     first_below + j);
+                }
+                if (above[i].end < below[j].end) {
+                        i++;
+                } else {
+                        j++;
+                }
+        }
+}
+
+/********** find_label ********
+ *
+ * Returns the root of the set holding a label, halving the path on the way.
+ *
+ * Parameters:
+ *      uint32_t *parent: the union-find, in which 0 marks a root
+ *      uint32_t label: the label
+ *
+ * Return: the label at the root of the set
+ *
+ * Notes:
+ *      Safe to run while other threads call find_label and unite_labels: a 
+ *      label only ever points at a smaller one, and halving only replaces
+ *      the parent of a label that is not a root with one of its ancestors.
+ ************************/
+static uint32_t find_label(uint32_t *parent, uint32_t label)
+{
+        uint32_t up = __atomic_load_n(&parent[label], __ATOMIC_ACQUIRE);
+        while (up != 0) {
+                uint32_t next = __atomic_load_n(&parent[up], 
+                                                __ATOMIC_ACQUIRE);
+                if (next == 0) {
+                        return up;
+                }
+                __atomic_store_n(&parent[label], next, __ATOMIC_RELAXED);
+                label = next;
+                up = __atomic_load_n(&parent[label], __ATOMIC_ACQUIRE);
+        }
+        return label;
+}
+
+/********** unite_labels ********
+ *
+ * Joins the sets holding two labels, without locks.
+ *
+ * Parameters:
+ *      uint32_t *parent: the union-find, in which 0 marks a root
+ *      uint32_t a, uint32_t b: the labels
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      The larger root is pointed at the smaller with a compare-and-swap, 
+ *      which fails if another thread has given it a parent first, in which
+ *      case both roots are found again. Since roots only point downwards, 
+ *      BORDER, the smallest label, is always a root.
+ ************************/
+static void unite_labels(uint32_t *parent, uint32_t a, uint32_t b)
+{
+        for (;;) {
+                a = find_label(parent, a);
+                b = find_label(parent, b);
+                if (a == b) {
+                        return;
+                }
+                if (a < b) {
+                        uint32_t swap = a;
+                        a = b;
+                        b = swap;
+                }
+                uint32_t root = 0;
+                if (__atomic_compare_exchange_n(&parent[a], &root, b, 0,
+                                                __ATOMIC_ACQ_REL,
+                                                __ATOMIC_ACQUIRE)) {
+                        return;
+                }
+        }
+}
+
+/********** clear_columns ********
+ *
+ * Clears the pixels of a row in columns [start, end), a word at a time.
+ *
+ * Parameters:
+ *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int row: the row
+ *      int start: the first column to clear
+ *      int end: one past the last column to clear
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void clear_columns(Bit2_T B2, int row, int start, int end)
+{
+        for (int w = start / 64; w <= (end - 1) / 64; w++) {
+                uint64_t mask = ~(uint64_t)0;
+                if (w == start / 64) {
+                        mask &= ~(uint64_t)0 << (start % 64);
+                }
+                if (w == (end - 1) / 64) {
+                        mask &= ~(uint64_t)0 >> (63 - (end - 1) % 64);
+                }
+                Bit2_put_word(B2, w, row, Bit2_get_word(B2, w, row) & ~mask);
+        }
+}
+
+/********** join_border ********
+ *
+ * Joins the runs of a row that lie on the border of the image to BORDER: 
+ * every run of the top and bottom rows, and any run that reaches the left or
+ * right side.
+ *
+ * Parameters:
+ *      uint32_t *parent: the union-find
+ *      struct run *runs, int n: the runs of the row
+ *      uint32_t first: the label of the first run
+ *      int row: the row
+ *      int width, int height: the size of the image
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void join_border(uint32_t *parent, struct run *runs, int n, 
+                        uint32_t first, int row, int width, int height)
+{
+        if (row == 0 || row == height - 1) {
+                for (int k = 0; k < n; k++) {
+                        unite_labels(parent, first + k, BORDER);
+                }
+        } else if (n > 0) {
+                if (runs[0].start == 0) {
+                        unite_labels(parent, first, BORDER);
+                }
+                if (runs[n - 1].end == width) {
+                        unite_labels(parent, first + n - 1, BORDER);
+                }
+        }
+}
+
+/********** remove_streaming ********
+ *
+ * Removes the black edges of a pbm while it is read, printing each row as
+ * soon as it is known which of its black runs reach the border.
+ *
+ * Parameters:
+ *      Pnmread_T *reader: address of the Pnmread object, just past the header
+ *      int width, int height: the size of the image
+ *      int raw: whether to print a raw (P4) pbm rather than a plain one
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      the value of the input pixels to be either 0 or 1
+ * Notes:
+ *      Will CRE if the memory cannot be allocated. A run is joined to the
+ *      runs it touches in the row above, and to BORDER if it lies on the 
+ *      border, as in label_stripe. A run's fate is known once its set is 
+ *      joined to BORDER, or once a row goes by with no run in its set, 
+ *      since nothing further down can reach it then. Rows are printed in 
+ *      order, so the window holds the oldest row still in doubt and every 
+ *      row after it; it starts at 64 rows and doubles when full. For text 
+ *      and drawings that is a few rows, but a shape that reaches the border
+ *      only far below where it starts keeps every row in between.
+ ************************/
+static void remove_streaming(Pnmread_T *reader, int width, int height, 
+                             int raw)
+{
+        struct stream S;
+        S.width = width;
+        S.height = height;
+        S.capacity = 64;
+        S.window = Bit2_new(width, S.capacity);
+        S.first_row = 0;
+        S.end_row = 0;
+        S.row_first = malloc(S.capacity * sizeof(uint32_t));
+        S.row_count = malloc(S.capacity * sizeof(int));
+        S.labels = FIRST_LABEL;
+        S.label_capacity = 0;
+        S.parent = NULL;
+        S.closed = NULL;
+        S.seen = NULL;
+        size_t most_runs = ((size_t)width + 1) / 2;
+        S.above = malloc(most_runs * sizeof(struct run));
+        S.below = malloc(most_runs * sizeof(struct run));
+        S.n_above = 0;
+        S.words = malloc(Bit2_words_per_row(S.window) * sizeof(uint64_t));
+        assert(S.row_first != NULL && S.row_count != NULL);
+        assert(S.above != NULL && S.below != NULL && S.words != NULL);
+
+        struct pbm_writer writer;
+        S.writer = &writer;
+        start_pbm(&writer, stdout, raw, width, height);
+        for (int row = 0; row < height; row++) {
+                if (row - S.first_row == S.capacity) {
+                        grow_window(&S);
+                }
+                int slot = row % S.capacity;
+                Pnmread_bits(*reader, S.window, slot);
+                int n = row_runs(S.window, slot, S.below);
+                reserve_labels(&S, n);
+                uint32_t first = S.labels;
+                S.labels += n;
+                S.row_first[slot] = first;
+                S.row_count[slot] = n;
+
+                join_border(S.parent, S.below, n, first, row, width, height);
+                if (row > 0) {
+                        join_rows(S.parent, S.above, S.n_above, 
+                                  S.row_first[(row - 1) % S.capacity], 
+                                  S.below, n, first);
+                        close_components(&S, row, n, first);
+                }
+                S.end_row = row + 1;
+
+                struct run *swap = S.above;
+                S.above = S.below;
+                S.below = swap;
+                S.n_above = n;
+                while (print_if_known(&S)) {
+                }
+        }
+        /* every run of the last row is on the border */
+        assert(S.first_row == S.end_row);
+        finish_pbm(&writer);
+
+        Bit2_free(&S.window);
+        free(S.row_first);
+        free(S.row_count);
+        free(S.parent);
+        free(S.closed);
+        free(S.seen);
+        free(S.above);
+        free(S.below);
+        free(S.words);
+}
+
+/********** close_components ********
+ *
+ * Marks as closed every set with a run in the row above a new row but none
+ * in the new row, as nothing can join such a set any more.
+ *
+ * Parameters:
+ *      struct stream *S: the stream, whose above holds the runs of row - 1
+ *      int row: the new row
+ *      int n_below: the number of runs in the new row
+ *      uint32_t first_below: the label of the first run of the new row
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Must be called once the new row has been joined to the row above.
+ ************************/
+static void close_components(struct stream *S, int row, int n_below, 
+                             uint32_t first_below)
+{
+        uint32_t stamp = (uint32_t)row + 1;
+        for (int k = 0; k < n_below; k++) {
+                S->seen[find_label(S->parent, first_below + k)] = stamp;
+        }
+        uint32_t first_above = S->row_first[(row - 1) % S->capacity];
+        for (int k = 0; k < S->n_above; k++) {
+                uint32_t root = find_label(S->parent, first_above + k);
+                if (root != BORDER && S->seen[root] != stamp) {
+                        S->closed[root] = 1;
+                }
+        }
+}
+
+/********** print_if_known ********
+ *
+ * Prints the oldest row of the window, with its runs that reach the border 
+ * cleared, if the fate of every run in it is known.
+ *
+ * Parameters:
+ *      struct stream *S: the stream
+ *
+ * Return: 1 if the row was printed and dropped from the window, else 0
+ ************************/
+static int print_if_known(struct stream *S)
+{
+        if (S->first_row == S->end_row) {
+                return 0;
+        }
+        int slot = S->first_row % S->capacity;
+        struct run *runs = S->below;
+        int n = row_runs(S->window, slot, runs);
+        uint32_t first = S->row_first[slot];
+        for (int k = 0; k < n; k++) {
+                uint32_t root = find_label(S->parent, first + k);
+                if (root != BORDER && !S->closed[root]) {
+                        return 0;
+                }
+        }
+
+        for (int k = 0; k < n; k++) {
+                if (find_label(S->parent, first + k) == BORDER) {
+                        clear_columns(S->window, slot, runs[k].start, 
+                                      runs[k].end);
+                }
+        }
+        for (int w = 0; w < Bit2_words_per_row(S->window); w++) {
+                S->words[w] = Bit2_get_word(S->window, w, slot);
+        }
+        print_row(S->first_row, S->words, S->width, S->writer);
+        S->first_row++;
+        return 1;
+}
+
+/********** grow_window ********
+ *
+ * Doubles the number of rows the window of a stream can hold.
+ *
+ * Parameters:
+ *      struct stream *S: the stream
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the memory cannot be allocated. Each row moves to its 
+ *      place in the larger ring, with its labels.
+ ************************/
+static void grow_window(struct stream *S)
+{
+        int capacity = 2 * S->capacity;
+        assert(capacity > S->capacity);
+        Bit2_T window = Bit2_new(S->width, capacity);
+        uint32_t *row_first = malloc(capacity * sizeof(uint32_t));
+        int *row_count = malloc(capacity * sizeof(int));
+        assert(row_first != NULL && row_count != NULL);
+        for (int row = S->first_row; row < S->end_row; row++) {
+                int from = row % S->capacity;
+                int to = row % capacity;
+                for (int w = 0; w < Bit2_words_per_row(window); w++) {
+                        Bit2_put_word(window, w, to, 
+                                      Bit2_get_word(S->window, w, from));
+                }
+                row_first[to] = S->row_first[from];
+                row_count[to] = S->row_count[from];
+        }
+        Bit2_free(&S->window);
+        free(S->row_first);
+        free(S->row_count);
+        S->window = window;
+        S->row_first = row_first;
+        S->row_count = row_count;
+        S->capacity = capacity;
+}
+
+/********** reserve_labels ********
+ *
+ * Makes room in the union-find of a stream for the labels of a new row.
+ *
+ * Parameters:
+ *      struct stream *S: the stream
+ *      uint32_t need: the number of labels needed
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the memory cannot be allocated. When the labels run 
+ *      out, the live ones are renumbered first, and the union-find only 
+ *      grows if that leaves it more than half full, so it stays within a 
+ *      small multiple of the runs in the window.
+ ************************/
+static void reserve_labels(struct stream *S, uint32_t need)
+{
+        if (S->labels + (uint64_t)need <= S->label_capacity) {
+                return;
+        }
+        if (S->parent != NULL) {
+                renumber_labels(S);
+        }
+        if (S->labels + (uint64_t)need <= S->label_capacity / 2) {
+                return;
+        }
+
+        uint64_t capacity = 2 * ((uint64_t)S->labels + need);
+        assert(capacity <= UINT32_MAX);
+        S->parent = realloc(S->parent, capacity * sizeof(uint32_t));
+        S->closed = realloc(S->closed, capacity);
+        S->seen = realloc(S->seen, capacity * sizeof(uint32_t));
+        assert(S->parent != NULL && S->closed != NULL && S->seen != NULL);
+        size_t added = capacity - S->label_capacity;
+        memset(S->parent + S->label_capacity, 0, added * sizeof(uint32_t));
+        memset(S->closed + S->label_capacity, 0, added);
+        memset(S->seen + S->label_capacity, 0, added * sizeof(uint32_t));
+        S->label_capacity = capacity;
+}
+
+/********** renumber_labels ********
+ *
+ * Renumbers the runs of the rows still needed, those in the window and the
+ * last row read, from FIRST_LABEL, dropping every other label.
+ *
+ * Parameters:
+ *      struct stream *S: the stream
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the memory cannot be allocated. Runs are numbered in
+ *      row-major order, so the first run of each set found becomes its new
+ *      root and the rest point at it, which keeps every label pointing at 
+ *      a smaller one; BORDER keeps its label, and a closed set stays closed.
+ ************************/
+static void renumber_labels(struct stream *S)
+{
+        uint32_t *map = calloc(S->labels, sizeof(uint32_t));
+        uint32_t *parent = calloc(S->label_capacity, sizeof(uint32_t));
+        unsigned char *closed = calloc(S->label_capacity, 1);
+        uint32_t *seen = calloc(S->label_capacity, sizeof(uint32_t));
+        assert(map != NULL && parent != NULL && closed != NULL);
+        assert(seen != NULL);
+
+        map[BORDER] = BORDER;
+        uint32_t label = FIRST_LABEL;
+        int start = (S->first_row < S->end_row) ? S->first_row : 
+                                                  S->end_row - 1;
+        for (int row = start; row < S->end_row; row++) {
+                int slot = row % S->capacity;
+                uint32_t first = S->row_first[slot];
+                S->row_first[slot] = label;
+                for (int k = 0; k < S->row_count[slot]; k++) {
+                        uint32_t root = find_label(S->parent, first + k);
+                        if (map[root] == 0) {
+                                map[root] = label;
+                                closed[label] = S->closed[root];
+                        } else {
+                                parent[label] = map[root];
                         }
-                } 
-                free(curr_pixel);
+                        label++;
+                }
+        }
+
+        free(map);
+        free(S->parent);
+        free(S->closed);
+        free(S->seen);
+        S->parent = parent;
+        S->closed = closed;
+        S->seen = seen;
+        S->labels = label;
+}
+
+/********** push_pixel ********
+ *
+ * Pushes a pixel onto the work stack, doubling the stack if it is full.
+ *
+ * Parameters:
+ *      struct work_stack *S: the work stack
+ *      int col: the column of the pixel
+ *      int row: the row of the pixel
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      col and row are non-negative
+ *      the memory can be allocated
+ * Notes:
+ *      Will CRE if the memory cannot be allocated.
+ ************************/
+static void push_pixel(struct work_stack *S, int col, int row)
+{
+        if (S->count == S->capacity) {
+                S->capacity = (S->capacity == 0) ? 1024 : 2 * S->capacity;
+                S->pixels = realloc(S->pixels, 
+                                    S->capacity * sizeof(uint64_t));
+                assert(S->pixels != NULL);
         }
+        S->pixels[S->count++] = ((uint64_t)row << 32) | (uint32_t)col;
 }
 
 /********** print_pbm ********
@@ -257,21 +1269,135 @@ void run_DFS(int start_col, int start_row, Bit2_T B2, int start_val, Stack_T S)
  *
  * Parameters:
  *      Bit2_T B2: a pointer to a Bit2_T struct
+ *      int raw: whether to print a raw (P4) pbm rather than a plain one
  *
  * Return: Doesn't return anything.
  *
  * Expects
  *      Bit2_T is not NULL, as checked in previous functions.
  * Notes:
- *      Uses printf to print the pbm to standard output.
+ *      Prints one row at a time through print_row, straight from the packed
+ *      words of each row.
  ************************/
-void print_pbm(Bit2_T B2) 
+void print_pbm(Bit2_T B2, int raw) 
 {
-        printf("P1\n%d %d\n", Bit2_width(B2), Bit2_height(B2));
-        for (int row = 0; row < Bit2_height(B2); row++) {
-                for (int col = 0; col < Bit2_width(B2); col++) {
-                        printf("%d ", Bit2_get(B2, col, row));
+        struct pbm_writer writer;
+        start_pbm(&writer, stdout, raw, Bit2_width(B2), Bit2_height(B2));
+        Bit2_map_rows_span(B2, print_row, &writer);
+        finish_pbm(&writer);
+}
+
+/* 
+ * the text of each byte of a row in a plain pbm, "0 " or "1 " for each of 
+ * its bits from the lowest up, and each byte with its bits reversed, as a 
+ * raw pbm puts the leftmost pixel in the highest bit
+ */
+static char plain_text[256][16];
+static unsigned char raw_byte[256];
+
+/********** start_pbm ********
+ *
+ * Prepares to write a pbm and writes its header.
+ *
+ * Parameters:
+ *      struct pbm_writer *W: the writer to set up
+ *      FILE *out: where to write the pbm
+ *      int raw: whether to write a raw (P4) pbm rather than a plain one
+ *      int width, int height: the size of the image
+ *
+ * Return: Doesn't return anything.
+ *
+ * Notes:
+ *      Will CRE if the memory cannot be allocated. The buffer holds 1 MB, or 
+ *      one row if a row is larger.
+ ************************/
+static void start_pbm(struct pbm_writer *W, FILE *out, int raw, int width,
+                      int height)
+{
+        for (int byte = 0; byte < 256; byte++) {
+                unsigned char reversed = 0;
+                for (int bit = 0; bit < 8; bit++) {
+                        plain_text[byte][2 * bit] = '0' + ((byte >> bit) & 1);
+                        plain_text[byte][2 * bit + 1] = ' ';
+                        reversed |= ((byte >> bit) & 1) << (7 - bit);
+                }
+                raw_byte[byte] = reversed;
+        }
+
+        size_t row_size = raw ? ((size_t)width + 7) / 8 : 2 * (size_t)width + 1;
+        W->out = out;
+        W->raw = raw;
+        W->used = 0;
+        W->size = (row_size > (1 << 20)) ? row_size : (1 << 20);
+        W->buffer = malloc(W->size);
+        assert(W->buffer != NULL);
+        fprintf(out, "%s\n%d %d\n", raw ? "P4" : "P1", width, height);
+}
+
+/********** finish_pbm ********
+ *
+ * Writes out whatever is left in the buffer of a pbm writer and frees it.
+ *
+ * Parameters:
+ *      struct pbm_writer *W: the writer
+ *
+ * Return: Doesn't return anything.
+ ************************/
+static void finish_pbm(struct pbm_writer *W)
+{
+        fwrite(W->buffer, 1, W->used, W->out);
+        fflush(W->out);
+        free(W->buffer);
+        W->buffer = NULL;
+}
+
+/********** print_row ********
+ *
+ * Adds one row of the pbm to the buffer of a pbm writer.
+ *
+ * Parameters:
+ *      int row: index of the row being printed (unused)
+ *      uint64_t *words: the packed bits of the row
+ *      int count: the number of pixels in the row
+ *      void *cl: the struct pbm_writer
+ *
+ * Return: Doesn't return anything.
+ *
+ * Expects
+ *      words holds at least count bits, as guaranteed by Bit2_map_rows_span,
+ *      and the bits past count are 0
+ * Notes:
+ *      Called by Bit2_map_rows_span for each row, top to bottom. A plain row
+ *      is made 8 pixels at a time from the text of each byte, and a raw row
+ *      a byte at a time; the buffer is written out first if the row would 
+ *      not fit.
+ ************************/
+void print_row(int row, uint64_t *words, int count, void *cl) 
+{
+        (void)row;
+        struct pbm_writer *W = cl;
+        size_t bytes = ((size_t)count + 7) / 8;
+        size_t row_size = W->raw ? bytes : 2 * (size_t)count + 1;
+        if (W->used + row_size > W->size) {
+                fwrite(W->buffer, 1, W->used, W->out);
+                W->used = 0;
+        }
+
+        char *p = W->buffer + W->used;
+        for (size_t i = 0; i < bytes; i++) {
+                unsigned byte = (words[i / 8] >> (8 * (i % 8))) & 0xff;
+                if (W->raw) {
+                        *p++ = raw_byte[byte];
+                } else if (8 * i + 8 <= (size_t)count) {
+                        memcpy(p, plain_text[byte], 16);
+                        p += 16;
+                } else {
+                        memcpy(p, plain_text[byte], 2 * (count % 8));
+                        p += 2 * (count % 8);
                 }
-                printf("\n");
         }
-}
\ No newline at end of file
+        if (!W->raw) {
+                *p++ = '\n';
+        }
+        W->used += row_size;
+}
@@ -0,0 +1,148 @@
+/*
+ *                      usebit2cursor.c
+ *
+ *         This program illustrates the use of Bit2_cursor and
+ *         Bit2_map_set_bits, in the style of usebit2.c: both should visit
+ *         the set bits in row-major order, each once, and a bit cleared
+ *         ahead of the traversal should not be visited while a bit set
+ *         ahead of it should.
+ *
+ *         Although it will catch some errors in some bit2 implementations
+ *         it is NOT a thorough test program.
+ *
+ *         Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <bit2.h>
+
+const int DIM1 = 150;   /* three words wide, the last one partial */
+const int DIM2 = 9;
+
+const int MARKER = 1;  /* can only be 1 or 0 */
+
+struct visits {
+        int count;
+        int last;       /* row-major index of the last bit visited */
+        bool OK;
+};
+
+void
+fill(Bit2_T a)
+{
+        for (int j = 0; j < DIM2; j++) {
+                for (int i = 0; i < DIM1; i++) {
+                        if ((i * 7 + j * 13) % 11 == 0 || i == 63 ||
+                            i == 64 || i == DIM1 - 1) {
+                                Bit2_put(a, i, j, MARKER);
+                        }
+                }
+        }
+}
+
+void
+check_order(int i, int j, Bit2_T a, void *p1)
+{
+        struct visits *v = p1;
+        v->OK &= (Bit2_get(a, i, j) == MARKER);
+        v->OK &= (j * DIM1 + i > v->last);
+        v->last = j * DIM1 + i;
+        v->count++;
+}
+
+/* clears the bit to the right and sets the bit below, both still ahead */
+void
+change_ahead(int i, int j, Bit2_T a, void *p1)
+{
+        check_order(i, j, a, p1);
+        if (i + 1 < DIM1) {
+                Bit2_put(a, i + 1, j, 0);
+        }
+        if (j + 1 < DIM2) {
+                Bit2_put(a, i, j + 1, MARKER);
+        }
+}
+
+/* the number of bits a traversal calling change_ahead should visit */
+int
+expected_visits(void)
+{
+        Bit2_T mirror = Bit2_new(DIM1, DIM2);
+        fill(mirror);
+        int n = 0;
+        for (int j = 0; j < DIM2; j++) {
+                for (int i = 0; i < DIM1; i++) {
+                        if (Bit2_get(mirror, i, j) == MARKER) {
+                                n++;
+                                if (i + 1 < DIM1) {
+                                        Bit2_put(mirror, i + 1, j, 0);
+                                }
+                                if (j + 1 < DIM2) {
+                                        Bit2_put(mirror, i, j + 1, MARKER);
+                                }
+                        }
+                }
+        }
+        Bit2_free(&mirror);
+        return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+        (void)argc;
+        (void)argv;
+
+        Bit2_T test_array = Bit2_new(DIM1, DIM2);
+        struct visits v = { 0, -1, true };
+        int col, row;
+        bool OK = true;
+
+        /* nothing to visit in an empty array */
+        Bit2_Cursor cursor = Bit2_cursor(test_array);
+        OK &= (Bit2_cursor_next(&cursor, &col, &row) == 0);
+
+        fill(test_array);
+
+        printf("Trying the cursor\n");
+        cursor = Bit2_cursor(test_array);
+        while (Bit2_cursor_next(&cursor, &col, &row)) {
+                check_order(col, row, test_array, &v);
+        }
+        OK &= v.OK;
+        OK &= ((size_t)v.count == Bit2_popcount(test_array));
+        OK &= (v.last == DIM2 * DIM1 - 1);
+        OK &= (Bit2_cursor_next(&cursor, &col, &row) == 0);
+
+        printf("Trying set bits\n");
+        v = (struct visits){ 0, -1, true };
+        Bit2_map_set_bits(test_array, check_order, &v);
+        OK &= v.OK;
+        OK &= ((size_t)v.count == Bit2_popcount(test_array));
+
+        printf("Trying the cursor, changing bits ahead of it\n");
+        v = (struct visits){ 0, -1, true };
+        cursor = Bit2_cursor(test_array);
+        while (Bit2_cursor_next(&cursor, &col, &row)) {
+                change_ahead(col, row, test_array, &v);
+        }
+        OK &= v.OK;
+        OK &= (v.count == expected_visits());
+
+        printf("Trying set bits, changing bits ahead of them\n");
+        Bit2_free(&test_array);
+        test_array = Bit2_new(DIM1, DIM2);
+        fill(test_array);
+        v = (struct visits){ 0, -1, true };
+        Bit2_map_set_bits(test_array, change_ahead, &v);
+        OK &= v.OK;
+        OK &= (v.count == expected_visits());
+
+        Bit2_free(&test_array);
+
+        printf("The cursor is %sOK!\n", (OK ? "" : "NOT "));
+
+}
@@ -0,0 +1,133 @@
+/*
+ *                      usebit2roar.c
+ *
+ *         This program illustrates the use of the bit2roar interface, in
+ *         the style of usebit2.c.
+ *
+ *         Although it will catch some errors in some bit2roar
+ *         implementations it is NOT a thorough test program.
+ *
+ *         Authors: Simon Rands (srands01) and Ian Ryan (iryan01)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <bit2roar.h>
+
+const int DIM1 = 150;   /* three tiles wide, the last one partial */
+const int DIM2 = 70;    /* two tiles high, the last one partial */
+
+const int MARKER = 1;  /* can only be 1 or 0 */
+
+void
+check_and_print(int i, int j, Bit2Roar_T a, void *p1)
+{
+        *((bool *)p1) &= Bit2Roar_get(a, i, j) == MARKER;
+        printf("ar[%d,%d]\n", i, j);
+}
+
+void
+count(int i, int j, Bit2Roar_T a, void *p1)
+{
+        (void)i;
+        (void)j;
+        (void)a;
+        (*(int *)p1)++;
+}
+
+int
+main(int argc, char *argv[])
+{
+        (void)argc;
+        (void)argv;
+
+        Bit2Roar_T test_array;
+        bool OK = true;
+
+        int x;
+
+        test_array = Bit2Roar_new(DIM1, DIM2);
+
+        OK = (Bit2Roar_width(test_array) == DIM1) &&
+             (Bit2Roar_height(test_array) == DIM2);
+
+        /* the corner, in the partial tile at the bottom right */
+        Bit2Roar_put(test_array, DIM1 - 1, DIM2 - 1, MARKER);
+        OK &= (Bit2Roar_get(test_array, DIM1 - 1, DIM2 - 1) == MARKER);
+
+        x = Bit2Roar_put(test_array, DIM1 - 1, DIM2 - 1, 0);
+        OK &= (x == MARKER);     /* put returns previous value */
+        OK &= (Bit2Roar_popcount(test_array) == 0);
+
+        Bit2Roar_put(test_array, DIM1 - 1, DIM2 - 1, MARKER);
+        Bit2Roar_put(test_array, 0, 0, MARKER);
+        printf("Trying set bits\n");
+        Bit2Roar_map_set_bits(test_array, check_and_print, &OK);
+
+        /* fill the top-left tile past the point where it becomes a bitmap,
+           then empty most of it again so that it turns back into an array */
+        for (int j = 0; j < 64; j++) {
+                for (int i = 0; i < 64; i++) {
+                        Bit2Roar_put(test_array, i, j, MARKER);
+                }
+        }
+        OK &= (Bit2Roar_popcount(test_array) == 64 * 64 + 1);
+        for (int j = 1; j < 64; j++) {
+                for (int i = 0; i < 64; i++) {
+                        Bit2Roar_put(test_array, i, j, 0);
+                }
+        }
+        OK &= (Bit2Roar_popcount(test_array) == 64 + 1);
+        OK &= (Bit2Roar_get(test_array, 63, 0) == MARKER);
+        OK &= (Bit2Roar_get(test_array, 63, 1) == 0);
+
+        /* the top row of the first tile is now one run */
+        size_t before = Bit2Roar_memory(test_array);
+        Bit2Roar_optimize(test_array);
+        OK &= (Bit2Roar_memory(test_array) < before);
+        OK &= (Bit2Roar_get(test_array, 10, 0) == MARKER);
+        x = Bit2Roar_put(test_array, 10, 0, 0);
+        OK &= (x == MARKER);
+        OK &= (Bit2Roar_get(test_array, 10, 0) == 0);
+        OK &= (Bit2Roar_get(test_array, 11, 0) == MARKER);
+
+        /* a vertical line, to combine with the top row */
+        Bit2Roar_T line = Bit2Roar_new(DIM1, DIM2);
+        for (int j = 0; j < DIM2; j++) {
+                Bit2Roar_put(line, 11, j, MARKER);
+        }
+        Bit2Roar_T both = Bit2Roar_and(test_array, line);
+        Bit2Roar_T either = Bit2Roar_or(test_array, line);
+        OK &= (Bit2Roar_popcount(both) == 1);
+        OK &= (Bit2Roar_get(both, 11, 0) == MARKER);
+        OK &= (Bit2Roar_popcount(either) ==
+               Bit2Roar_popcount(test_array) + DIM2 - 1);
+
+        int n = 0;
+        Bit2Roar_map_set_bits(either, count, &n);
+        OK &= ((size_t)n == Bit2Roar_popcount(either));
+
+        /* round trip through a dense Bit2 */
+        Bit2_T dense = Bit2Roar_to_bit2(either);
+        OK &= (Bit2_popcount(dense) == Bit2Roar_popcount(either));
+        OK &= (Bit2_get(dense, DIM1 - 1, DIM2 - 1) == MARKER);
+        Bit2Roar_T back = Bit2Roar_from_bit2(dense);
+        for (int j = 0; j < DIM2; j++) {
+                for (int i = 0; i < DIM1; i++) {
+                        OK &= (Bit2Roar_get(back, i, j) ==
+                               Bit2Roar_get(either, i, j));
+                }
+        }
+
+        Bit2_free(&dense);
+        Bit2Roar_free(&back);
+        Bit2Roar_free(&either);
+        Bit2Roar_free(&both);
+        Bit2Roar_free(&line);
+        Bit2Roar_free(&test_array);
+
+        printf("The array is %sOK!\n", (OK ? "" : "NOT "));
+
+}